@@ -16,827 +16,3690 @@
 
 #include <stdlib.h>
 
+#ifdef ATOMICX_SCHED_POLICY_HEADER
+#include ATOMICX_SCHED_POLICY_HEADER
+#endif
+
+#if ATOMICX_STACK_COMPRESS && defined(ATOMICX_STACK_CODEC_HEADER)
+#include ATOMICX_STACK_CODEC_HEADER
+#endif
+
+#if ATOMICX_NO_HEAP && ATOMICX_AUTO_STACK
+#error "ATOMICX_AUTO_STACK allocates from the heap, not available with ATOMICX_NO_HEAP"
+#endif
+
+#if ! ATOMICX_AUTO_STACK && (ATOMICX_STACK_ARENA || ATOMICX_STACK_POOL || ATOMICX_STACK_COMPRESS)
+#error "ATOMICX_STACK_ARENA, ATOMICX_STACK_POOL and ATOMICX_STACK_COMPRESS manage auto stacks, not available without ATOMICX_AUTO_STACK (or with ATOMICX_NO_HEAP)"
+#endif
+
+#if ! ATOMICX_TIMING_STATS && (ATOMICX_DYNAMIC_NICE || ATOMICX_STACK_COMPRESS)
+#error "ATOMICX_DYNAMIC_NICE and ATOMICX_STACK_COMPRESS use the thread execution times, not available without ATOMICX_TIMING_STATS"
+#endif
+
+#if ATOMICX_STACK_COPY_KERNELS
+#if ! defined(__x86_64__) || ! (defined(__GNUC__) || defined(__clang__))
+#error "ATOMICX_STACK_COPY_KERNELS is only available for x86-64 with GCC or Clang"
+#elif ATOMICX_DEDICATED_STACK
+#error "ATOMICX_STACK_COPY_KERNELS is only available for the copy backend"
+#endif
+#include <cpuid.h>
+#include <immintrin.h>
+#include <x86intrin.h>
+#endif
+
+#if ATOMICX_DEDICATED_STACK
+/*
+ * Save the callee saved registers on the current stack, store the stack
+ * pointer in *ppSave, load pNew as stack pointer and restore the registers
+ * saved there, returning into the other context.
+ */
+extern "C" void atomicx_switch_stack (void** ppSave, void* pNew);
+
+#if defined(__x86_64__)
+// Frame: r15 r14 r13 r12 rbx rbp, return address
+static const size_t ms_nStackFrameWords = 8;
+static const size_t ms_nStackReturnWord = 6;
+
+asm (
+    ".text\n"
+    ".globl atomicx_switch_stack\n"
+    ".type atomicx_switch_stack, @function\n"
+    "atomicx_switch_stack:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size atomicx_switch_stack, .-atomicx_switch_stack\n"
+);
+#elif defined(__aarch64__)
+// Frame: x19-x28, x29, x30 (return address), d8-d15
+static const size_t ms_nStackFrameWords = 22;
+static const size_t ms_nStackReturnWord = 11;
+
+asm (
+    ".text\n"
+    ".globl atomicx_switch_stack\n"
+    ".type atomicx_switch_stack, %function\n"
+    "atomicx_switch_stack:\n"
+    "    sub sp, sp, #176\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x2, sp\n"
+    "    str x2, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #176\n"
+    "    ret\n"
+    ".size atomicx_switch_stack, .-atomicx_switch_stack\n"
+);
+#else
+#error "ATOMICX_DEDICATED_STACK is only available for x86-64 and AArch64"
+#endif
+#endif
+
 namespace thread
 {
     // Static initializations
     static atomicx* ms_paFirst=nullptr;
     static atomicx* ms_paLast=nullptr;
-    static jmp_buf ms_joinContext{};
     static atomicx* ms_pCurrent=nullptr;
     static bool ms_running=false;
 
-    atomicx::semaphore::semaphore(size_t nMaxShared) : m_maxShared(nMaxShared)
+    /*
+     * Thread registry, slots are handed out from the free list or, while it is empty,
+     * from the never used ones. The generation changes every time a slot is freed.
+     * With a heap the table doubles when full, the first ATOMICX_THREAD_SLOTS are static.
+     */
+    static_assert (ATOMICX_THREAD_SLOTS > 0 && ATOMICX_THREAD_SLOTS < 0xffff, "ATOMICX_THREAD_SLOTS must be 1 to 65534");
+
+    static const uint16_t ms_nNoSlot = 0xffff;
+
+    struct threadSlot
     {
-    }
+        atomicx* pThread;
+        uint16_t nGeneration;
+        uint16_t nNextFree;
+    };
 
-    size_t atomicx::semaphore::GetMax ()
+    static threadSlot ms_aStaticSlots[ATOMICX_THREAD_SLOTS];
+    static threadSlot* ms_aSlots=ms_aStaticSlots;
+    static uint16_t ms_nSlotsSize=ATOMICX_THREAD_SLOTS;
+
+    static uint16_t ms_nSlotsUsed=0;
+    static uint16_t ms_nFreeSlot=ms_nNoSlot;
+    static size_t ms_nSlotMisses=0;
+    static size_t ms_nThreadCount=0;
+
+#if ATOMICX_DEDICATED_STACK
+    // Kernel (Start) stack pointer while threads run on their own stacks
+    static void* ms_pKernelStack=nullptr;
+    static atomicx* ms_pFinished=nullptr;
+    // Set by a thread whose stack overflowed, the kernel calls its handler from the kernel stack
+    static atomicx* ms_pOverflowed=nullptr;
+#if ATOMICX_AUTO_STACK
+    static volatile uint8_t* ms_pReleasedStack=nullptr;
+#endif
+
+    // Written at the low end of every stack when it is prepared and checked on every switch
+    static const uint8_t ms_aStackCanary[16] = {0xC0, 0xDE, 0xCA, 0xFE, 0x5A, 0xFE, 0xD0, 0x0D,
+                                                0xC0, 0xDE, 0xCA, 0xFE, 0x5A, 0xFE, 0xD0, 0x0D};
+
+    static bool IsCanaryIntact (volatile uint8_t* pStack)
     {
-        return (size_t) ~0;
+        return pStack == nullptr || memcmp ((const void*) pStack, ms_aStackCanary, sizeof (ms_aStackCanary)) == 0;
     }
 
-    bool atomicx::semaphore::acquire(atomicx_time nTimeout)
-    {
-        Timeout timeout(nTimeout);
+#if ATOMICX_STACK_PROFILE
+    // Painted over the whole stack when it is prepared, the first other byte is the high water mark
+    static const uint8_t ms_nStackPaint = 0xA5;
+#endif
+#else
+    static jmp_buf ms_joinContext{};
+    static bool ms_selected=false;
+#endif
 
-        while (m_counter >= m_maxShared)
-        {
-            if (timeout.IsTimedout () || GetCurrent() == nullptr || GetCurrent()->Wait (*this, 1, timeout.GetRemaining()) == false)
-            {
-                return false;
-            }
-        }
+    // Runnable threads are owned by the scheduler policy
+    using schedPolicy = ATOMICX_SCHED_POLICY;
 
-        m_counter++;
+#if ATOMICX_TIMER_WHEEL
+    // Hierarchical timing wheel, ATOMICX_WHEEL_LEVELS x 64 slots plus an overflow list
+    static const uint8_t ms_wheelSlotBits = 6;
+    static const uint8_t ms_wheelSlots = 1 << ms_wheelSlotBits;
+    static const uint16_t ms_wheelOverflow = ATOMICX_WHEEL_LEVELS * ms_wheelSlots;
 
-        return true;
-    }
+    static atomicx* ms_paWheel[ATOMICX_WHEEL_LEVELS][ms_wheelSlots]{};
+    static uint64_t ms_wheelMap[ATOMICX_WHEEL_LEVELS]{};
+    static atomicx* ms_pWheelOverflow=nullptr;
+    static atomicx_time ms_wheelNow=0;
+    static size_t ms_nWheelCount=0;
+#else
+    static atomicx* ms_pTimers=nullptr;
+#endif
 
-    void atomicx::semaphore::release()
+    // Waiting threads indexed by reference pointer
+    static_assert ((ATOMICX_WAIT_BUCKETS & (ATOMICX_WAIT_BUCKETS - 1)) == 0, "ATOMICX_WAIT_BUCKETS must be a power of 2");
+
+    static atomicx* ms_paWaitBuckets[ATOMICX_WAIT_BUCKETS]{};
+
+    static inline atomicx** GetWaitBucket(const void* pLockId)
     {
-        if (m_counter && GetCurrent() != nullptr)
-        {
-            m_counter --;
+        size_t nHash = (size_t) pLockId;
 
-            GetCurrent()->Notify (*this, 1, NotifyType::one);
-        }
+        nHash ^= nHash >> 4;
+        nHash ^= nHash >> 9;
+
+        return &ms_paWaitBuckets[nHash & (ATOMICX_WAIT_BUCKETS - 1)];
     }
 
-    size_t atomicx::semaphore::GetCount ()
+#if ATOMICX_STACK_ARENA || ATOMICX_STACK_POOL
+#if ATOMICX_DEDICATED_STACK
+#error "ATOMICX_STACK_ARENA and ATOMICX_STACK_POOL are only available for the copy backend"
+#endif
+    // Stack arena size classes, multiples of 16 bytes up to 128, then 4 classes per power of 2
+    static const size_t ms_nArenaGrain = 16;
+    static const size_t ms_nArenaLinear = 128;
+
+    static constexpr uint8_t ArenaLog2(size_t nValue)
     {
-        return m_counter;
+        return nValue <= 1 ? 0 : (uint8_t) (1 + ArenaLog2(nValue >> 1));
     }
 
-    size_t atomicx::semaphore::GetMaxAcquired ()
+    static_assert ((ATOMICX_STACK_ARENA_MAX & (ATOMICX_STACK_ARENA_MAX - 1)) == 0 && ATOMICX_STACK_ARENA_MAX >= 256, "ATOMICX_STACK_ARENA_MAX must be a power of 2 and at least 256");
+    static_assert (ATOMICX_STACK_ARENA_CHUNK % ms_nArenaGrain == 0, "ATOMICX_STACK_ARENA_CHUNK must be a multiple of 16");
+
+    static const uint8_t ms_nArenaClasses = (uint8_t) (ms_nArenaLinear / ms_nArenaGrain + 4 * (ArenaLog2 (ATOMICX_STACK_ARENA_MAX) - ArenaLog2 (ms_nArenaLinear)));
+
+    // Free blocks are linked through their first word
+    static void* ms_paArenaFree[ms_nArenaClasses]{};
+    static uint8_t* ms_pArenaChunk=nullptr;
+    static size_t ms_nArenaChunkLeft=0;
+    static size_t ms_nArenaInUse=0;
+    static size_t ms_nArenaReserved=0;
+
+    static inline uint8_t ArenaClass(size_t nSize)
     {
-        return m_maxShared;
+        if (nSize <= ms_nArenaLinear)
+        {
+            return nSize == 0 ? 0 : (uint8_t) ((nSize - 1) / ms_nArenaGrain);
+        }
+
+        uint8_t nPower = ArenaLog2 ((nSize - 1) / ms_nArenaLinear);
+
+        return (uint8_t) (ms_nArenaLinear / ms_nArenaGrain + nPower * 4 + (nSize - (ms_nArenaLinear << nPower) - 1) / ((ms_nArenaLinear / 4) << nPower));
     }
 
-    size_t atomicx::semaphore::GetWaitCount ()
+    static inline size_t ArenaClassSize(uint8_t nClass)
     {
-        return GetCurrent() != nullptr ? GetCurrent()->HasWaitings (*this, 1) : 0;
-    }
+        if (nClass < ms_nArenaLinear / ms_nArenaGrain)
+        {
+            return (nClass + 1) * ms_nArenaGrain;
+        }
 
-    // Smart Semaphore, manages the semaphore com comply with RII
-    atomicx::smartSemaphore::smartSemaphore(semaphore& sem) : m_sem(sem)
-    {}
+        nClass = (uint8_t) (nClass - ms_nArenaLinear / ms_nArenaGrain);
 
-    atomicx::smartSemaphore::~smartSemaphore()
+        return (ms_nArenaLinear << (nClass / 4)) + (nClass % 4 + 1) * ((ms_nArenaLinear / 4) << (nClass / 4));
+    }
+
+    static inline void ArenaPush(void* pBlock, uint8_t nClass)
     {
-        release ();
+        *(void**) pBlock = ms_paArenaFree[nClass];
+        ms_paArenaFree[nClass] = pBlock;
     }
 
-    bool atomicx::smartSemaphore::acquire(atomicx_time nTimeout)
+    /*
+    * Allocate a saved stack region of at least nSize bytes, nSize is
+    * updated to the real block size, which must be given back on free
+    */
+    static volatile uint8_t* StackArenaAlloc(size_t& nSize)
     {
-        if (bAcquired == false && m_sem.acquire (nTimeout))
+        void* pBlock = nullptr;
+
+        if (nSize > ATOMICX_STACK_ARENA_MAX)
         {
-            bAcquired = true;
+            pBlock = malloc (nSize);
         }
         else
         {
-            return false;
+            uint8_t nClass = ArenaClass (nSize);
+
+            nSize = ArenaClassSize (nClass);
+
+            if ((pBlock = ms_paArenaFree[nClass]) != nullptr)
+            {
+                ms_paArenaFree[nClass] = *(void**) pBlock;
+                ms_nArenaInUse += nSize;
+
+                return (volatile uint8_t*) pBlock;
+            }
+            else if (nSize <= ATOMICX_STACK_ARENA_CHUNK)
+            {
+                if (ms_nArenaChunkLeft < nSize)
+                {
+                    // Hand the chunk tail over to the smaller classes
+                    while (ms_nArenaChunkLeft >= ms_nArenaGrain)
+                    {
+                        uint8_t nTail = ArenaClass (ms_nArenaChunkLeft);
+                        size_t nTailSize;
+
+                        if ((nTailSize = ArenaClassSize (nTail)) > ms_nArenaChunkLeft)
+                        {
+                            nTailSize = ArenaClassSize (--nTail);
+                        }
+
+                        ArenaPush (ms_pArenaChunk, nTail);
+
+                        ms_pArenaChunk += nTailSize;
+                        ms_nArenaChunkLeft -= nTailSize;
+                    }
+
+                    if ((ms_pArenaChunk = (uint8_t*) malloc (ATOMICX_STACK_ARENA_CHUNK)) == nullptr)
+                    {
+                        ms_nArenaChunkLeft = 0;
+
+                        return nullptr;
+                    }
+
+                    ms_nArenaChunkLeft = ATOMICX_STACK_ARENA_CHUNK;
+                    ms_nArenaReserved += ATOMICX_STACK_ARENA_CHUNK;
+                }
+
+                pBlock = ms_pArenaChunk;
+
+                ms_pArenaChunk += nSize;
+                ms_nArenaChunkLeft -= nSize;
+                ms_nArenaInUse += nSize;
+
+                return (volatile uint8_t*) pBlock;
+            }
+            else
+            {
+                pBlock = malloc (nSize);
+            }
         }
 
-        return true;
+        if (pBlock != nullptr)
+        {
+            ms_nArenaReserved += nSize;
+            ms_nArenaInUse += nSize;
+        }
+
+        return (volatile uint8_t*) pBlock;
     }
 
-    void atomicx::smartSemaphore::release()
+    static void StackArenaFree(volatile uint8_t* pStack, size_t nSize)
     {
-        if (bAcquired)
+        ms_nArenaInUse -= nSize;
+
+        if (nSize > ATOMICX_STACK_ARENA_MAX)
         {
-            m_sem.release ();
+            ms_nArenaReserved -= nSize;
+
+            free ((void*) pStack);
+        }
+        else
+        {
+            ArenaPush ((void*) pStack, ArenaClass (nSize));
         }
     }
 
-    size_t atomicx::smartSemaphore::GetCount ()
+    size_t atomicx::GetStackArenaInUse()
     {
-        return m_sem.GetCount ();
+        return ms_nArenaInUse;
     }
 
-    size_t atomicx::smartSemaphore::GetMaxAcquired ()
+    size_t atomicx::GetStackArenaReserved()
     {
-        return m_sem.GetMaxAcquired();
+        return ms_nArenaReserved;
     }
+#endif
 
-    size_t atomicx::smartSemaphore::GetWaitCount ()
+#if ATOMICX_STACK_INCREMENTAL
+#if ATOMICX_DEDICATED_STACK || ATOMICX_STACK_ARENA
+#error "ATOMICX_STACK_INCREMENTAL is only available for the copy backend without ATOMICX_STACK_ARENA"
+#endif
+    static_assert (ATOMICX_STACK_CHUNK > 0, "ATOMICX_STACK_CHUNK must not be 0");
+
+    static size_t ms_nStackCopied=0;
+    static size_t ms_nStackSkipped=0;
+
+    /*
+    * Copy nSize bytes writing only the chunks that differ, chunks are
+    * aligned to the end (stack base) so the same frames always compare
+    * against each other. Never inlined: restoring runs over the Yield
+    * frame, its locals must live below it.
+    */
+    static __attribute__((noinline)) void CopyDirtyChunks(volatile uint8_t* pTo, const volatile uint8_t* pFrom, size_t nSize)
     {
-        return m_sem.GetWaitCount ();
+        size_t nChunk = nSize % ATOMICX_STACK_CHUNK;
+
+        if (nChunk == 0)
+        {
+            nChunk = ATOMICX_STACK_CHUNK;
+        }
+
+        for (size_t nOffset = 0; nOffset < nSize; nOffset += nChunk, nChunk = ATOMICX_STACK_CHUNK)
+        {
+            if (memcmp ((const void*) (pTo + nOffset), (const void*) (pFrom + nOffset), nChunk) != 0)
+            {
+                memcpy ((void*) (pTo + nOffset), (const void*) (pFrom + nOffset), nChunk);
+
+                ms_nStackCopied += nChunk;
+            }
+            else
+            {
+                ms_nStackSkipped += nChunk;
+            }
+        }
     }
 
-    bool atomicx::smartSemaphore::IsAcquired ()
+    size_t atomicx::GetStackBytesCopied()
     {
-        return bAcquired;
+        return ms_nStackCopied;
     }
 
-    atomicx::Timeout::Timeout () : m_timeoutValue (0)
+    size_t atomicx::GetStackBytesSkipped()
     {
-        Set (0);
+        return ms_nStackSkipped;
     }
+#endif
 
-    atomicx::Timeout::Timeout (atomicx_time nTimeoutValue) : m_timeoutValue (0)
+#if ATOMICX_STACK_COPY_KERNELS
+    /*
+    * Stack copy kernels, the stores are aligned after an unaligned head
+    * and the tail is an overlapping unaligned store, no byte loops
+    */
+    static void StackCopyPortable(void* pTo, const void* pFrom, size_t nSize)
     {
-        Set (nTimeoutValue);
+        memcpy (pTo, pFrom, nSize);
     }
 
-    void atomicx::Timeout::Set(atomicx_time nTimeoutValue)
+    static void StackCopySse2(void* pTo, const void* pFrom, size_t nSize)
     {
-        m_timeoutValue = nTimeoutValue ? nTimeoutValue + Atomicx_GetTick () : 0;
+        uint8_t* pDst = (uint8_t*) pTo;
+        const uint8_t* pSrc = (const uint8_t*) pFrom;
+
+        if (nSize < 16)
+        {
+            memcpy (pDst, pSrc, nSize);
+
+            return;
+        }
+
+        size_t nHead = (16 - ((uintptr_t) pDst & 15)) & 15;
+        __m128i nLast = _mm_loadu_si128 ((const __m128i*) (pSrc + nSize - 16));
+
+        _mm_storeu_si128 ((__m128i*) pDst, _mm_loadu_si128 ((const __m128i*) pSrc));
+
+        pDst += nHead;
+        pSrc += nHead;
+        nSize -= nHead;
+
+        for (; nSize >= 64; nSize -= 64, pDst += 64, pSrc += 64)
+        {
+            __m128i n0 = _mm_loadu_si128 ((const __m128i*) pSrc);
+            __m128i n1 = _mm_loadu_si128 ((const __m128i*) (pSrc + 16));
+            __m128i n2 = _mm_loadu_si128 ((const __m128i*) (pSrc + 32));
+            __m128i n3 = _mm_loadu_si128 ((const __m128i*) (pSrc + 48));
+
+            _mm_store_si128 ((__m128i*) pDst, n0);
+            _mm_store_si128 ((__m128i*) (pDst + 16), n1);
+            _mm_store_si128 ((__m128i*) (pDst + 32), n2);
+            _mm_store_si128 ((__m128i*) (pDst + 48), n3);
+        }
+
+        for (; nSize >= 16; nSize -= 16, pDst += 16, pSrc += 16)
+        {
+            _mm_store_si128 ((__m128i*) pDst, _mm_loadu_si128 ((const __m128i*) pSrc));
+        }
+
+        _mm_storeu_si128 ((__m128i*) (pDst + nSize - 16), nLast);
     }
 
-    bool atomicx::Timeout::IsTimedout()
+    static void StackCopyErms(void* pTo, const void* pFrom, size_t nSize)
     {
-        return (m_timeoutValue == 0 || Atomicx_GetTick () < m_timeoutValue) ? false : true;
+        __asm__ __volatile__ ("rep movsb" : "+D" (pTo), "+S" (pFrom), "+c" (nSize) : : "memory");
     }
 
-    atomicx_time atomicx::Timeout::GetRemaining()
+    __attribute__((target("avx2"))) static void StackCopyAvx2(void* pTo, const void* pFrom, size_t nSize)
     {
-        auto nNow = Atomicx_GetTick ();
+        uint8_t* pDst = (uint8_t*) pTo;
+        const uint8_t* pSrc = (const uint8_t*) pFrom;
 
-        return (nNow < m_timeoutValue) ? m_timeoutValue - nNow : 0;
-    }
+        if (nSize < 32)
+        {
+            StackCopySse2 (pDst, pSrc, nSize);
 
-    atomicx_time atomicx::Timeout::GetDurationSince(atomicx_time startTime)
-    {
-        return startTime - GetRemaining ();
-    }
+            return;
+        }
 
-    // atomicx::aiterator::aiterator(atomicx* ptr) : m_ptr(ptr)
-    // {}
+        size_t nHead = (32 - ((uintptr_t) pDst & 31)) & 31;
+        __m256i nLast = _mm256_loadu_si256 ((const __m256i*) (pSrc + nSize - 32));
 
-    // atomicx& atomicx::aiterator::operator*() const
-    // {
-    //     return *m_ptr;
-    // }
+        _mm256_storeu_si256 ((__m256i*) pDst, _mm256_loadu_si256 ((const __m256i*) pSrc));
 
-    // atomicx* atomicx::aiterator::operator->()
-    // {
-    //     return m_ptr;
-    // }
+        pDst += nHead;
+        pSrc += nHead;
+        nSize -= nHead;
 
-    // atomicx::aiterator& atomicx::aiterator::operator++()
-    // {
-    //     if (m_ptr != nullptr) m_ptr = m_ptr->m_paNext;
-    //     return *this;
-    // }
+        for (; nSize >= 128; nSize -= 128, pDst += 128, pSrc += 128)
+        {
+            __m256i n0 = _mm256_loadu_si256 ((const __m256i*) pSrc);
+            __m256i n1 = _mm256_loadu_si256 ((const __m256i*) (pSrc + 32));
+            __m256i n2 = _mm256_loadu_si256 ((const __m256i*) (pSrc + 64));
+            __m256i n3 = _mm256_loadu_si256 ((const __m256i*) (pSrc + 96));
+
+            _mm256_store_si256 ((__m256i*) pDst, n0);
+            _mm256_store_si256 ((__m256i*) (pDst + 32), n1);
+            _mm256_store_si256 ((__m256i*) (pDst + 64), n2);
+            _mm256_store_si256 ((__m256i*) (pDst + 96), n3);
+        }
 
-    iterator<atomicx> atomicx::begin() { return iterator<atomicx>(ms_paFirst); }
-    iterator<atomicx> atomicx::end()   { return iterator<atomicx>(nullptr); }
+        for (; nSize >= 32; nSize -= 32, pDst += 32, pSrc += 32)
+        {
+            _mm256_store_si256 ((__m256i*) pDst, _mm256_loadu_si256 ((const __m256i*) pSrc));
+        }
 
-    atomicx* atomicx::operator++ (void)
+        _mm256_storeu_si256 ((__m256i*) (pDst + nSize - 32), nLast);
+        _mm256_zeroupper ();
+    }
+
+    typedef void (*stackCopyKernel)(void* pTo, const void* pFrom, size_t nSize);
+
+    /*
+     * No kernel wins at every depth (see examples/pc/stackcopy), so Start() times each one
+     * on every depth class and StackCopyByDepth() dispatches to the fastest for the size
+     */
+    static const size_t ms_nStackCopyClasses = 4;
+    static const size_t ms_aStackCopyClassSize[ms_nStackCopyClasses] = {1024, 2048, 4096, 8192};
+
+    static stackCopyKernel ms_apStackCopyByDepth[ms_nStackCopyClasses] = {StackCopyPortable, StackCopyPortable, StackCopyPortable, StackCopyPortable};
+    static atomicx::StackCopy ms_aStackCopyByDepth[ms_nStackCopyClasses] = {};
+
+    static stackCopyKernel ms_pStackCopy = StackCopyPortable;
+    static bool ms_stackCopyForced = false;
+
+    static size_t GetStackCopyClass(size_t nSize)
     {
-        return m_paNext;
+        // Halfway between the calibrated sizes
+        return nSize < 1536 ? 0 : nSize < 3072 ? 1 : nSize < 6144 ? 2 : 3;
     }
 
-    atomicx* atomicx::GetCurrent()
+    static void StackCopyByDepth(void* pTo, const void* pFrom, size_t nSize)
     {
-        return ms_pCurrent;
+        ms_apStackCopyByDepth[GetStackCopyClass (nSize)] (pTo, pFrom, nSize);
     }
 
-    void atomicx::AddThisThread()
+    static bool IsStackCopySupported(atomicx::StackCopy kernel)
     {
-        if (ms_paFirst == nullptr)
-        {
-            ms_paFirst = this;
-            ms_paLast = ms_paFirst;
-        }
-        else
+        unsigned int nEax, nEbx, nEcx, nEdx;
+
+        switch (kernel)
         {
-            this->m_paPrev = ms_paLast;
-            ms_paLast->m_paNext = this;
-            ms_paLast = this;
+            case atomicx::StackCopy::portable:
+            case atomicx::StackCopy::sse2:
+                return true;
+
+            case atomicx::StackCopy::erms:
+                // CPUID.(EAX=7,ECX=0):EBX bit 9
+                return __get_cpuid_count (7, 0, &nEax, &nEbx, &nEcx, &nEdx) && (nEbx & (1 << 9));
+
+            case atomicx::StackCopy::avx2:
+                // Also checks the OS saves the AVX state
+                __builtin_cpu_init ();
+                return __builtin_cpu_supports ("avx2");
         }
+
+        return false;
     }
 
-    void atomicx::RemoveThisThread()
+    static stackCopyKernel GetStackCopyKernel(atomicx::StackCopy kernel)
     {
-        if (m_paNext == nullptr && m_paPrev == nullptr)
-        {
-            ms_paFirst = nullptr;
-            m_paPrev = nullptr;
-            ms_pCurrent = nullptr;
-        }
-        else if (m_paPrev == nullptr)
-        {
-            m_paNext->m_paPrev = nullptr;
-            ms_paFirst = m_paNext;
-            ms_pCurrent = ms_paFirst;
-        }
-        else if (m_paNext == nullptr)
-        {
-            m_paPrev->m_paNext = nullptr;
-            ms_paLast = m_paPrev;
-            ms_pCurrent = ms_paFirst;
-        }
-        else
+        switch (kernel)
         {
-            m_paPrev->m_paNext = m_paNext;
-            m_paNext->m_paPrev = m_paPrev;
-            ms_pCurrent = m_paNext->m_paPrev;
+            case atomicx::StackCopy::sse2: return StackCopySse2;
+            case atomicx::StackCopy::erms: return StackCopyErms;
+            case atomicx::StackCopy::avx2: return StackCopyAvx2;
+            default: break;
         }
+
+        return StackCopyPortable;
     }
 
-    bool atomicx::SelectNextThread()
+    static void CalibrateStackCopy()
     {
-        atomicx* pItem = ms_paFirst;
+        static uint8_t aFrom[8192], aTo[8192];
+        const atomicx::StackCopy aKernels[] = {atomicx::StackCopy::portable, atomicx::StackCopy::sse2, atomicx::StackCopy::erms, atomicx::StackCopy::avx2};
 
-        if (pItem != nullptr) do
+        for (size_t nClass = 0; nClass < ms_nStackCopyClasses; nClass++)
         {
-            if (pItem->m_aStatus == aTypes::stop)
-            {
-                continue;
-            }
+            uint64_t nBest = ~((uint64_t) 0);
 
-            if (ms_pCurrent->m_nTargetTime == 0 && pItem->m_nTargetTime > 0)
+            for (atomicx::StackCopy kernel : aKernels)
             {
-                ms_pCurrent = pItem;
-            }
+                if (IsStackCopySupported (kernel) == false)
+                {
+                    continue;
+                }
 
-            if (pItem->m_aStatus == aTypes::start || pItem->m_aStatus == aTypes::now)
-            {
-                ms_pCurrent = pItem;
-                break;
-            }
-            else if ((pItem->m_aStatus == aTypes::sleep || (pItem->m_aStatus == aTypes::wait && pItem->m_nTargetTime > 0)) && ms_pCurrent->m_nTargetTime >= pItem->m_nTargetTime)
-            {
-                ms_pCurrent = pItem;
-            }
+                stackCopyKernel pKernel = GetStackCopyKernel (kernel);
+                uint64_t nFastest = ~((uint64_t) 0);
 
-        } while ((pItem = pItem->m_paNext));
+                // Best of a few rounds, one warms the caches up and the others filter interruptions out
+                for (size_t nRound = 0; nRound < 8; nRound++)
+                {
+                    uint64_t nStart = __rdtsc ();
 
-        if (ms_pCurrent == nullptr)
-        {
-            return false;
-        }
-        else
-        {
-            switch (ms_pCurrent->m_aStatus)
-            {
-                case aTypes::wait:
-                    if (ms_pCurrent->m_nTargetTime > 0)
+                    for (size_t nCopy = 0; nCopy < 16; nCopy++)
                     {
-                        ms_pCurrent->m_aSubStatus = aSubTypes::timeout;
+                        pKernel (aTo, aFrom, ms_aStackCopyClassSize[nClass]);
                     }
-                    else
+
+                    uint64_t nElapsed = __rdtsc () - nStart;
+
+                    if (nElapsed < nFastest)
                     {
-                        // A blocked wait should never come here if the system was not in deadlock.
-                        return false;
+                        nFastest = nElapsed;
                     }
+                }
 
-                case aTypes::sleep:
+                if (nFastest < nBest)
                 {
-                    atomicx_time nCurrent = Atomicx_GetTick();
-
-                    (void) Atomicx_SleepTick(nCurrent < ms_pCurrent->m_nTargetTime ? ms_pCurrent->m_nTargetTime - nCurrent : 0);
-
-                    break;
+                    nBest = nFastest;
+                    ms_apStackCopyByDepth[nClass] = pKernel;
+                    ms_aStackCopyByDepth[nClass] = kernel;
                 }
+            }
+        }
 
-                case aTypes::running:
-                case aTypes::start:
-                case aTypes::now:
-                    break;
+        ms_pStackCopy = StackCopyByDepth;
+    }
 
-                default:
-                    return false;
-            }
+    bool atomicx::SetStackCopy(StackCopy kernel)
+    {
+        if (IsStackCopySupported (kernel) == false)
+        {
+            return false;
         }
 
-        if (ms_pCurrent->m_flags.dynamicNice == true)
+        ms_pStackCopy = GetStackCopyKernel (kernel);
+
+        for (size_t nClass = 0; nClass < ms_nStackCopyClasses; nClass++)
         {
-            ms_pCurrent->m_nice = ((ms_pCurrent->m_LastUserExecTime) + ms_pCurrent->m_nice) / 2;
+            ms_apStackCopyByDepth[nClass] = ms_pStackCopy;
+            ms_aStackCopyByDepth[nClass] = kernel;
         }
 
+        ms_stackCopyForced = true;
+
         return true;
     }
 
-    bool atomicx::Start(void)
+    atomicx::StackCopy atomicx::GetStackCopy(size_t nSize)
     {
-        if (ms_paFirst != nullptr)
-        {
-            ms_running = true;
-            ms_pCurrent = ms_paFirst;
+        return ms_aStackCopyByDepth[GetStackCopyClass (nSize)];
+    }
+#endif
+
+#if ATOMICX_STACK_COMPRESS
+#if ATOMICX_DEDICATED_STACK
+#error "ATOMICX_STACK_COMPRESS is only available for the copy backend"
+#endif
+    using stackCodec = ATOMICX_STACK_CODEC;
+
+    // Smaller saved stacks are not worth compressing
+    static const size_t ms_nCompressMin = 128;
+
+    static size_t ms_nCompressedBytes=0;
+    static size_t ms_nUncompressedBytes=0;
+
+    // Auto stack threads parked with a saved stack, in park time order, so a sweep stops at the first not due
+    static atomicx* ms_pParkedFirst=nullptr;
+    static atomicx* ms_pParkedLast=nullptr;
+
+    static volatile uint8_t* StackBufferAlloc(size_t& nSize)
+    {
+#if ATOMICX_STACK_ARENA || ATOMICX_STACK_POOL
+        return StackArenaAlloc (nSize);
+#else
+        return (volatile uint8_t*) malloc (nSize);
+#endif
+    }
+
+    static void StackBufferFree(volatile uint8_t* pStack, size_t nSize)
+    {
+#if ATOMICX_STACK_ARENA || ATOMICX_STACK_POOL
+        StackArenaFree (pStack, nSize);
+#else
+        (void) nSize;
+
+        free ((void*) pStack);
+#endif
+    }
+
+    size_t atomicx::GetStackCompressedSize()
+    {
+        return ms_nCompressedBytes;
+    }
+
+    size_t atomicx::GetStackUncompressedSize()
+    {
+        return ms_nUncompressedBytes;
+    }
+#endif
+
+    atomicx::semaphore::semaphore(size_t nMaxShared) : m_maxShared(nMaxShared)
+    {
+    }
+
+    size_t atomicx::semaphore::GetMax ()
+    {
+        return (size_t) ~0;
+    }
+
+    bool atomicx::semaphore::acquire(atomicx_time nTimeout)
+    {
+        Timeout timeout(nTimeout);
+
+        while (m_counter >= m_maxShared)
+        {
+            if (GetCurrent() == nullptr)
+            {
+                return false;
+            }
+
+            // Binary semaphore works as a lock, lend our priority to its holder
+            if (m_pOwner != nullptr)
+            {
+                GetCurrent()->LockWaitStarted (m_pOwner);
+            }
+
+            // Once the deadline passed the remaining time is 0, which would wait forever
+            atomicx_time nRemaining = timeout.GetRemaining ();
+            bool bNotified = (nTimeout == 0 || nRemaining > 0) && GetCurrent()->Wait (*this, 1, nRemaining);
+
+            GetCurrent()->LockWaitEnded ();
+
+            if (bNotified == false)
+            {
+                return false;
+            }
+        }
+
+        m_counter++;
+
+        if (m_maxShared == 1 && GetCurrent() != nullptr)
+        {
+            m_pOwner = GetCurrent();
+            m_pOwner->LockAcquired (m_held);
+        }
+
+        return true;
+    }
+
+    void atomicx::semaphore::release()
+    {
+        if (m_counter && GetCurrent() != nullptr)
+        {
+            m_counter --;
+
+            if (m_pOwner != nullptr)
+            {
+                m_pOwner->LockReleased (m_held);
+                m_pOwner = nullptr;
+            }
+
+            GetCurrent()->Notify (*this, 1, NotifyType::one);
+        }
+    }
+
+    size_t atomicx::semaphore::GetCount ()
+    {
+        return m_counter;
+    }
+
+    size_t atomicx::semaphore::GetMaxAcquired ()
+    {
+        return m_maxShared;
+    }
+
+    size_t atomicx::semaphore::GetWaitCount ()
+    {
+        return GetCurrent() != nullptr ? GetCurrent()->HasWaitings (*this, 1) : 0;
+    }
+
+    // Smart Semaphore, manages the semaphore com comply with RII
+    atomicx::smartSemaphore::smartSemaphore(semaphore& sem) : m_sem(sem)
+    {}
+
+    atomicx::smartSemaphore::~smartSemaphore()
+    {
+        release ();
+    }
+
+    bool atomicx::smartSemaphore::acquire(atomicx_time nTimeout)
+    {
+        if (bAcquired == false && m_sem.acquire (nTimeout))
+        {
+            bAcquired = true;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    void atomicx::smartSemaphore::release()
+    {
+        if (bAcquired)
+        {
+            m_sem.release ();
+        }
+    }
+
+    size_t atomicx::smartSemaphore::GetCount ()
+    {
+        return m_sem.GetCount ();
+    }
+
+    size_t atomicx::smartSemaphore::GetMaxAcquired ()
+    {
+        return m_sem.GetMaxAcquired();
+    }
+
+    size_t atomicx::smartSemaphore::GetWaitCount ()
+    {
+        return m_sem.GetWaitCount ();
+    }
+
+    bool atomicx::smartSemaphore::IsAcquired ()
+    {
+        return bAcquired;
+    }
+
+    atomicx::Timeout::Timeout () : m_timeoutValue (0)
+    {
+        Set (0);
+    }
+
+    atomicx::Timeout::Timeout (atomicx_time nTimeoutValue) : m_timeoutValue (0)
+    {
+        Set (nTimeoutValue);
+    }
+
+    void atomicx::Timeout::Set(atomicx_time nTimeoutValue)
+    {
+        m_timeoutValue = nTimeoutValue ? nTimeoutValue + Atomicx_GetTick () : 0;
+    }
+
+    bool atomicx::Timeout::IsTimedout()
+    {
+        return (m_timeoutValue == 0 || Atomicx_GetTick () < m_timeoutValue) ? false : true;
+    }
+
+    atomicx_time atomicx::Timeout::GetRemaining()
+    {
+        auto nNow = Atomicx_GetTick ();
+
+        return (nNow < m_timeoutValue) ? m_timeoutValue - nNow : 0;
+    }
+
+    atomicx_time atomicx::Timeout::GetDurationSince(atomicx_time startTime)
+    {
+        return startTime - GetRemaining ();
+    }
+
+    // atomicx::aiterator::aiterator(atomicx* ptr) : m_ptr(ptr)
+    // {}
+
+    // atomicx& atomicx::aiterator::operator*() const
+    // {
+    //     return *m_ptr;
+    // }
+
+    // atomicx* atomicx::aiterator::operator->()
+    // {
+    //     return m_ptr;
+    // }
+
+    // atomicx::aiterator& atomicx::aiterator::operator++()
+    // {
+    //     if (m_ptr != nullptr) m_ptr = m_ptr->m_paNext;
+    //     return *this;
+    // }
+
+    iterator<atomicx> atomicx::begin() { return iterator<atomicx>(ms_paFirst); }
+    iterator<atomicx> atomicx::end()   { return iterator<atomicx>(nullptr); }
+
+    atomicx* atomicx::operator++ (void)
+    {
+        return m_paNext;
+    }
+
+    atomicx* atomicx::GetCurrent()
+    {
+        return ms_pCurrent;
+    }
+
+    bool atomicx::GrowSlots()
+    {
+#if ATOMICX_NO_HEAP
+        return false;
+#else
+        uint16_t nSize = ms_nSlotsSize < ms_nNoSlot / 2 ? (uint16_t) (ms_nSlotsSize * 2) : (uint16_t) (ms_nNoSlot - 1);
+
+        if (nSize <= ms_nSlotsSize)
+        {
+            return false;
+        }
+
+        threadSlot* pSlots = (threadSlot*) malloc (nSize * sizeof (threadSlot));
+
+        if (pSlots == nullptr)
+        {
+            return false;
+        }
+
+        memcpy ((void*) pSlots, (const void*) ms_aSlots, ms_nSlotsSize * sizeof (threadSlot));
+
+        if (ms_aSlots != ms_aStaticSlots)
+        {
+            free ((void*) ms_aSlots);
+        }
+
+        ms_aSlots = pSlots;
+        ms_nSlotsSize = nSize;
+
+        return true;
+#endif
+    }
+
+    size_t atomicx::GetHandleMisses()
+    {
+        return ms_nSlotMisses;
+    }
+
+    void atomicx::AddThisThread()
+    {
+        if (ms_nFreeSlot != ms_nNoSlot)
+        {
+            m_nSlot = ms_nFreeSlot;
+            ms_nFreeSlot = ms_aSlots[m_nSlot].nNextFree;
+        }
+        else if (ms_nSlotsUsed < ms_nSlotsSize || GrowSlots ())
+        {
+            m_nSlot = ms_nSlotsUsed++;
+            ms_aSlots[m_nSlot].nGeneration = 1;
+        }
+        else
+        {
+            m_nSlot = ms_nNoSlot;
+            ms_nSlotMisses++;
+        }
+
+        if (m_nSlot != ms_nNoSlot)
+        {
+            ms_aSlots[m_nSlot].pThread = this;
+        }
+
+        ms_nThreadCount++;
+
+        if (ms_paFirst == nullptr)
+        {
+            ms_paFirst = this;
+            ms_paLast = ms_paFirst;
+        }
+        else
+        {
+            this->m_paPrev = ms_paLast;
+            ms_paLast->m_paNext = this;
+            ms_paLast = this;
+        }
+    }
+
+    void atomicx::RemoveThisThread()
+    {
+        if (m_nSlot != ms_nNoSlot)
+        {
+            ms_aSlots[m_nSlot].pThread = nullptr;
+
+            // Never 0, so zero initialized handles stay invalid
+            if (++ms_aSlots[m_nSlot].nGeneration == 0)
+            {
+                ms_aSlots[m_nSlot].nGeneration = 1;
+            }
+
+            ms_aSlots[m_nSlot].nNextFree = ms_nFreeSlot;
+            ms_nFreeSlot = m_nSlot;
+            m_nSlot = ms_nNoSlot;
+        }
+
+        ms_nThreadCount--;
+
+#if ATOMICX_STACK_COMPRESS
+        RemoveThisThreadFromParkedList ();
+#endif
+
+        // Waiters of a lock this thread still holds must not follow it in the inheritance chain
+        for (heldLock* pLock = m_pHeldLocks; pLock != nullptr; pLock = pLock->pNext)
+        {
+            for (atomicx* pWaiter = GetWaitQueue (pLock->pLockId); pWaiter != nullptr; pWaiter = pWaiter->m_pWaitNext)
+            {
+                if (pWaiter->m_pBlockedBy == this)
+                {
+                    pWaiter->m_pBlockedBy = nullptr;
+                }
+            }
+        }
+
+        // ms_pCurrent is left alone, a thread removing itself still has to Yield away
+        if (m_paPrev == nullptr)
+        {
+            ms_paFirst = m_paNext;
+        }
+        else
+        {
+            m_paPrev->m_paNext = m_paNext;
+        }
+
+        if (m_paNext == nullptr)
+        {
+            ms_paLast = m_paPrev;
+        }
+        else
+        {
+            m_paNext->m_paPrev = m_paPrev;
+        }
+
+        m_paNext = nullptr;
+        m_paPrev = nullptr;
+    }
+
+    void atomicx::PushRunQueue(atomicx*& pFirst, atomicx*& pLast, atomicx& thr)
+    {
+        thr.m_pRunNext = nullptr;
+        thr.m_pRunPrev = pLast;
+
+        if (pLast == nullptr)
+        {
+            pFirst = &thr;
+        }
+        else
+        {
+            pLast->m_pRunNext = &thr;
+        }
+
+        pLast = &thr;
+    }
+
+    void atomicx::PushReadyQueue(atomicx& thr)
+    {
+        thr.m_aQueue = aQueues::ready;
+        schedPolicy::Ready (thr);
+    }
+
+    void atomicx::PushExpiredQueue(atomicx& thr)
+    {
+        thr.m_aQueue = aQueues::expired;
+        schedPolicy::Expired (thr);
+    }
+
+    void atomicx::RemoveRunQueue(atomicx*& pFirst, atomicx*& pLast, atomicx& thr)
+    {
+        if (thr.m_pRunPrev == nullptr)
+        {
+            pFirst = thr.m_pRunNext;
+        }
+        else
+        {
+            thr.m_pRunPrev->m_pRunNext = thr.m_pRunNext;
+        }
+
+        if (thr.m_pRunNext == nullptr)
+        {
+            pLast = thr.m_pRunPrev;
+        }
+        else
+        {
+            thr.m_pRunNext->m_pRunPrev = thr.m_pRunPrev;
+        }
+
+        thr.m_pRunNext = nullptr;
+        thr.m_pRunPrev = nullptr;
+    }
+
+    atomicx* atomicx::HeapMeld(atomicx* pHeapA, atomicx* pHeapB, atomicx_time atomicx::* pKey)
+    {
+        if (pHeapA == nullptr) return pHeapB;
+        if (pHeapB == nullptr) return pHeapA;
+
+        if (pHeapB->*pKey < pHeapA->*pKey)
+        {
+            atomicx* pSwap = pHeapA;
+            pHeapA = pHeapB;
+            pHeapB = pSwap;
+        }
+
+        // The loser becomes the first child of the winner
+        pHeapB->m_pRunPrev = pHeapA;
+        pHeapB->m_pRunNext = pHeapA->m_pHeapChild;
+
+        if (pHeapA->m_pHeapChild != nullptr)
+        {
+            pHeapA->m_pHeapChild->m_pRunPrev = pHeapB;
+        }
+
+        pHeapA->m_pHeapChild = pHeapB;
+
+        return pHeapA;
+    }
+
+    atomicx* atomicx::HeapMergePairs(atomicx* pFirst, atomicx_time atomicx::* pKey)
+    {
+        atomicx* pPairs = nullptr;
+
+        // First pass, meld siblings two by two from left to right
+        while (pFirst != nullptr)
+        {
+            atomicx* pHeapA = pFirst;
+            atomicx* pHeapB = pHeapA->m_pRunNext;
+
+            pFirst = pHeapB != nullptr ? pHeapB->m_pRunNext : nullptr;
+
+            pHeapA->m_pRunNext = pHeapA->m_pRunPrev = nullptr;
+
+            if (pHeapB != nullptr)
+            {
+                pHeapB->m_pRunNext = pHeapB->m_pRunPrev = nullptr;
+                pHeapA = HeapMeld (pHeapA, pHeapB, pKey);
+            }
+
+            pHeapA->m_pRunNext = pPairs;
+            pPairs = pHeapA;
+        }
+
+        atomicx* pRoot = nullptr;
+
+        // Second pass, meld the pairs back from right to left
+        while (pPairs != nullptr)
+        {
+            atomicx* pNext = pPairs->m_pRunNext;
+
+            pPairs->m_pRunNext = nullptr;
+            pRoot = HeapMeld (pRoot, pPairs, pKey);
+
+            pPairs = pNext;
+        }
+
+        return pRoot;
+    }
+
+    atomicx* atomicx::HeapPop(atomicx*& pRoot, atomicx_time atomicx::* pKey)
+    {
+        atomicx* pTop = pRoot;
+
+        if (pTop != nullptr)
+        {
+            pRoot = HeapMergePairs (pTop->m_pHeapChild, pKey);
+            pTop->m_pHeapChild = nullptr;
+        }
+
+        return pTop;
+    }
+
+    void atomicx::HeapRemove(atomicx*& pRoot, atomicx& thr, atomicx_time atomicx::* pKey)
+    {
+        if (pRoot == &thr)
+        {
+            (void) HeapPop (pRoot, pKey);
+
+            return;
+        }
+
+        // Cut the sub-heap off its parent, m_pRunPrev is the parent only for the first child
+        if (thr.m_pRunPrev->m_pHeapChild == &thr)
+        {
+            thr.m_pRunPrev->m_pHeapChild = thr.m_pRunNext;
+        }
+        else
+        {
+            thr.m_pRunPrev->m_pRunNext = thr.m_pRunNext;
+        }
+
+        if (thr.m_pRunNext != nullptr)
+        {
+            thr.m_pRunNext->m_pRunPrev = thr.m_pRunPrev;
+        }
+
+        thr.m_pRunNext = thr.m_pRunPrev = nullptr;
+
+        pRoot = HeapMeld (pRoot, HeapMergePairs (thr.m_pHeapChild, pKey), pKey);
+        thr.m_pHeapChild = nullptr;
+    }
+
+#if ATOMICX_TIMER_WHEEL
+    static_assert (ATOMICX_WHEEL_LEVELS > 0 && ATOMICX_WHEEL_LEVELS * 6 < sizeof (atomicx_time) * 8, "ATOMICX_WHEEL_LEVELS must fit in atomicx_time");
+
+    static inline uint8_t WheelLowestSlot(uint64_t nMap)
+    {
+#if defined(__GNUC__)
+        return (uint8_t) __builtin_ctzll (nMap);
+#else
+        uint8_t nSlot = 0;
+
+        while ((nMap & 1) == 0)
+        {
+            nMap >>= 1;
+            nSlot++;
+        }
+
+        return nSlot;
+#endif
+    }
+
+    void atomicx::TimerArm(atomicx& thr)
+    {
+        atomicx_time nTarget = thr.m_nTargetTime;
+        atomicx_time nCurrent = ms_wheelNow + 1;
+
+        thr.m_pRunNext = thr.m_pRunPrev = nullptr;
+
+        if (nTarget < nCurrent)
+        {
+            PushExpiredQueue (thr);
+
+            return;
+        }
+
+        atomicx** ppHead = &ms_pWheelOverflow;
+        thr.m_nTimerSlot = ms_wheelOverflow;
+
+        // The level is the lowest one whose upper block is shared with the wheel time
+        for (uint8_t nLevel = 0; nLevel < ATOMICX_WHEEL_LEVELS; nLevel++)
+        {
+            uint8_t nShift = (uint8_t) (ms_wheelSlotBits * (nLevel + 1));
+
+            if ((nTarget >> nShift) == (nCurrent >> nShift))
+            {
+                uint8_t nSlot = (uint8_t) ((nTarget >> (nShift - ms_wheelSlotBits)) & (ms_wheelSlots - 1));
+
+                ppHead = &ms_paWheel[nLevel][nSlot];
+                ms_wheelMap[nLevel] |= ((uint64_t) 1) << nSlot;
+                thr.m_nTimerSlot = (uint16_t) (nLevel * ms_wheelSlots + nSlot);
+
+                break;
+            }
+        }
+
+        thr.m_pRunNext = *ppHead;
+
+        if (*ppHead != nullptr)
+        {
+            (*ppHead)->m_pRunPrev = &thr;
+        }
+
+        *ppHead = &thr;
+        thr.m_aQueue = aQueues::timer;
+
+        ms_nWheelCount++;
+    }
+
+    void atomicx::TimerCancel(atomicx& thr)
+    {
+        if (thr.m_pRunNext != nullptr)
+        {
+            thr.m_pRunNext->m_pRunPrev = thr.m_pRunPrev;
+        }
+
+        if (thr.m_pRunPrev != nullptr)
+        {
+            thr.m_pRunPrev->m_pRunNext = thr.m_pRunNext;
+        }
+        else if (thr.m_nTimerSlot == ms_wheelOverflow)
+        {
+            ms_pWheelOverflow = thr.m_pRunNext;
+        }
+        else
+        {
+            uint8_t nLevel = (uint8_t) (thr.m_nTimerSlot / ms_wheelSlots);
+            uint8_t nSlot = (uint8_t) (thr.m_nTimerSlot % ms_wheelSlots);
+
+            if ((ms_paWheel[nLevel][nSlot] = thr.m_pRunNext) == nullptr)
+            {
+                ms_wheelMap[nLevel] &= ~(((uint64_t) 1) << nSlot);
+            }
+        }
+
+        thr.m_pRunNext = thr.m_pRunPrev = nullptr;
+
+        ms_nWheelCount--;
+    }
+
+    bool atomicx::TimerNext(atomicx_time& nNext)
+    {
+        if (ms_nWheelCount == 0)
+        {
+            return false;
+        }
+
+        atomicx_time nCurrent = ms_wheelNow + 1;
+
+        // Levels are ordered in time, the first occupied slot gives the next event, exact for
+        // level 0 and the slot start for upper levels (that will be cascaded by then)
+        for (uint8_t nLevel = 0; nLevel < ATOMICX_WHEEL_LEVELS; nLevel++)
+        {
+            uint8_t nShift = (uint8_t) (ms_wheelSlotBits * nLevel);
+            uint8_t nIndex = (uint8_t) ((nCurrent >> nShift) & (ms_wheelSlots - 1));
+            uint64_t nMap = ms_wheelMap[nLevel] & (~((uint64_t) 0) << nIndex);
+
+            if (nMap != 0)
+            {
+                atomicx_time nBlock = (nCurrent >> (nShift + ms_wheelSlotBits)) << (nShift + ms_wheelSlotBits);
+
+                nNext = nBlock | ((atomicx_time) WheelLowestSlot (nMap) << nShift);
+
+                return true;
+            }
+        }
+
+        uint8_t nShift = (uint8_t) (ms_wheelSlotBits * ATOMICX_WHEEL_LEVELS);
+
+        nNext = ((nCurrent >> nShift) + 1) << nShift;
+
+        return true;
+    }
+
+    void atomicx::WheelAdvance(atomicx_time nTo)
+    {
+        atomicx_time nCurrent = nTo + 1;
+
+        ms_wheelNow = nTo;
+
+        // Entering a new block, cascade from the top so entries can flow down more than one level at once
+        if ((nCurrent & (atomicx_time) ~(ATOMICX_TIME_MAX << (ms_wheelSlotBits * ATOMICX_WHEEL_LEVELS))) == 0)
+        {
+            atomicx* pItem = ms_pWheelOverflow;
+            ms_pWheelOverflow = nullptr;
+
+            while (pItem != nullptr)
+            {
+                atomicx* pNext = pItem->m_pRunNext;
+                ms_nWheelCount--;
+                TimerArm (*pItem);
+                pItem = pNext;
+            }
+        }
+
+        for (uint8_t nLevel = ATOMICX_WHEEL_LEVELS - 1; nLevel > 0; nLevel--)
+        {
+            uint8_t nShift = (uint8_t) (ms_wheelSlotBits * nLevel);
+
+            if ((nCurrent & (atomicx_time) ~(ATOMICX_TIME_MAX << nShift)) == 0)
+            {
+                uint8_t nSlot = (uint8_t) ((nCurrent >> nShift) & (ms_wheelSlots - 1));
+                atomicx* pItem = ms_paWheel[nLevel][nSlot];
+
+                ms_paWheel[nLevel][nSlot] = nullptr;
+                ms_wheelMap[nLevel] &= ~(((uint64_t) 1) << nSlot);
+
+                while (pItem != nullptr)
+                {
+                    atomicx* pNext = pItem->m_pRunNext;
+                    ms_nWheelCount--;
+                    TimerArm (*pItem);
+                    pItem = pNext;
+                }
+            }
+        }
+    }
+
+    void atomicx::TimerExpire(atomicx_time nNow)
+    {
+        atomicx_time nNext = 0;
+
+        while (TimerNext (nNext) && nNext <= nNow)
+        {
+            // Nothing is armed before nNext, so it is safe to jump straight to it
+            if (nNext - 1 != ms_wheelNow)
+            {
+                WheelAdvance (nNext - 1);
+            }
+
+            uint8_t nSlot = (uint8_t) (nNext & (ms_wheelSlots - 1));
+            atomicx* pItem = ms_paWheel[0][nSlot];
+
+            ms_paWheel[0][nSlot] = nullptr;
+            ms_wheelMap[0] &= ~(((uint64_t) 1) << nSlot);
+
+            while (pItem != nullptr)
+            {
+                atomicx* pNext = pItem->m_pRunNext;
+
+                ms_nWheelCount--;
+                PushExpiredQueue (*pItem);
+
+                pItem = pNext;
+            }
+
+            WheelAdvance (nNext);
+        }
+
+        if (nNow > ms_wheelNow)
+        {
+            WheelAdvance (nNow);
+        }
+    }
+#else
+    void atomicx::TimerArm(atomicx& thr)
+    {
+        thr.m_pRunNext = thr.m_pRunPrev = thr.m_pHeapChild = nullptr;
+        ms_pTimers = HeapMeld (ms_pTimers, &thr, &atomicx::m_nTargetTime);
+        thr.m_aQueue = aQueues::timer;
+    }
+
+    void atomicx::TimerCancel(atomicx& thr)
+    {
+        HeapRemove (ms_pTimers, thr, &atomicx::m_nTargetTime);
+    }
+
+    bool atomicx::TimerNext(atomicx_time& nNext)
+    {
+        if (ms_pTimers == nullptr)
+        {
+            return false;
+        }
+
+        nNext = ms_pTimers->m_nTargetTime;
+
+        return true;
+    }
+
+    void atomicx::TimerExpire(atomicx_time nNow)
+    {
+        // Move all due sleepers and timed waits, in target time order, to the expired queue
+        while (ms_pTimers != nullptr && ms_pTimers->m_nTargetTime <= nNow)
+        {
+            atomicx* pItem = HeapPop (ms_pTimers, &atomicx::m_nTargetTime);
+
+            PushExpiredQueue (*pItem);
+        }
+    }
+#endif
+
+    atomicx* atomicx::GetWaitQueue(const void* pLockId)
+    {
+        atomicx* pChannel = *GetWaitBucket (pLockId);
+
+        while (pChannel != nullptr && pChannel->m_pLockId != pLockId)
+        {
+            pChannel = pChannel->m_pWaitChannel;
+        }
+
+        return pChannel;
+    }
+
+    void atomicx::AddThisThreadToWaitQueue()
+    {
+        atomicx** ppBucket = GetWaitBucket (m_pLockId);
+        atomicx* pChannel = GetWaitQueue (m_pLockId);
+
+        m_pWaitNext = nullptr;
+        m_pWaitChannel = nullptr;
+
+        if (pChannel == nullptr)
+        {
+            // First waiter, it becomes the channel
+            m_pWaitPrev = nullptr;
+            m_pWaitLast = this;
+            m_pWaitChannel = *ppBucket;
+            *ppBucket = this;
+        }
+        else
+        {
+            m_pWaitPrev = pChannel->m_pWaitLast;
+            pChannel->m_pWaitLast->m_pWaitNext = this;
+            pChannel->m_pWaitLast = this;
+        }
+
+        m_flags.waitQueued = true;
+    }
+
+    void atomicx::RemoveThisThreadFromWaitQueue()
+    {
+        if (m_pWaitPrev != nullptr)
+        {
+            m_pWaitPrev->m_pWaitNext = m_pWaitNext;
+
+            if (m_pWaitNext != nullptr)
+            {
+                m_pWaitNext->m_pWaitPrev = m_pWaitPrev;
+            }
+            else
+            {
+                GetWaitQueue (m_pLockId)->m_pWaitLast = m_pWaitPrev;
+            }
+        }
+        else
+        {
+            // This is the channel, hand it over to the next waiter if any
+            atomicx** ppChannel = GetWaitBucket (m_pLockId);
+
+            while (*ppChannel != this)
+            {
+                ppChannel = &(*ppChannel)->m_pWaitChannel;
+            }
+
+            if (m_pWaitNext != nullptr)
+            {
+                m_pWaitNext->m_pWaitPrev = nullptr;
+                m_pWaitNext->m_pWaitLast = m_pWaitLast;
+                m_pWaitNext->m_pWaitChannel = m_pWaitChannel;
+                *ppChannel = m_pWaitNext;
+            }
+            else
+            {
+                *ppChannel = m_pWaitChannel;
+            }
+        }
+
+        m_pWaitNext = m_pWaitPrev = m_pWaitLast = m_pWaitChannel = nullptr;
+
+        m_flags.waitQueued = false;
+    }
+
+    void atomicx::NotifyThisThread(size_t nMessage, size_t nTag)
+    {
+        DequeueThisThread ();
+
+        m_aStatus = aTypes::now;
+        m_nTargetTime = 0;
+        m_pLockId = nullptr;
+
+        m_lockMessage.message = nMessage;
+        m_lockMessage.tag = nTag;
+
+        EnqueueThisThread ();
+    }
+
+    size_t atomicx::TransferTo(const void* pLockId, const Segment* pSegments, size_t nSegments, Delivery* pDeliveries, size_t nServed, size_t nReceivers)
+    {
+        size_t nMessageSize = 0;
+
+        for (size_t nSegment = 0; nSegment < nSegments; nSegment++)
+        {
+            nMessageSize += pSegments [nSegment].nSize;
+        }
+
+        while (nServed < nReceivers)
+        {
+            atomicx* pReceiver = nullptr;
+
+            for (atomicx* pThr = GetWaitQueue (pLockId); pThr != nullptr; pThr = pThr->m_pWaitNext)
+            {
+                if (pThr->m_aStatus != aTypes::wait || pThr->m_aSubStatus != aSubTypes::transfer
+                    || (pReceiver != nullptr && pThr->m_nPriority <= pReceiver->m_nPriority))
+                {
+                    continue;
+                }
+
+                size_t nIndex = 0;
+
+                while (nIndex < nServed && pDeliveries [nIndex].pReceiver != pThr)
+                {
+                    nIndex++;
+                }
+
+                if (nIndex == nServed)
+                {
+                    pReceiver = pThr;
+                }
+            }
+
+            if (pReceiver == nullptr)
+            {
+                break;
+            }
+
+            // A waiting receiver lends its buffer in the message and its size in the tag
+            uint8_t* pBuffer = (uint8_t*) pReceiver->m_lockMessage.message;
+            size_t nCapacity = pReceiver->m_lockMessage.tag;
+            size_t nCopied = 0;
+
+            for (size_t nSegment = 0; nSegment < nSegments && nCopied < nCapacity; nSegment++)
+            {
+                size_t nSize = pSegments [nSegment].nSize < nCapacity - nCopied ? pSegments [nSegment].nSize : nCapacity - nCopied;
+
+                memcpy ((void*) (pBuffer + nCopied), (const void*) pSegments [nSegment].pData, nSize);
+
+                nCopied += nSize;
+            }
+
+            pReceiver->NotifyThisThread (nCopied, nMessageSize);
+
+            pDeliveries [nServed++] = {pReceiver, nCopied};
+        }
+
+        return nServed;
+    }
+
+    bool atomicx::IsOnThreadStack(const void* pData)
+    {
+#if ATOMICX_DEDICATED_STACK
+        // Dedicated stacks stay in place while the thread is parked
+        (void) pData;
+
+        return false;
+#else
+        volatile uint8_t nStackEnd = 0;
+
+        return (uintptr_t) pData >= (uintptr_t) &nStackEnd && (uintptr_t) pData <= (uintptr_t) m_pStaskStart;
+#endif
+    }
+
+    void atomicx::EnqueueThisThread()
+    {
+        DequeueThisThread ();
+
+        if (m_flags.attached == false)
+        {
+            return;
+        }
+
+        switch (m_aStatus)
+        {
+            case aTypes::start:
+            case aTypes::now:
+                PushReadyQueue (*this);
+                break;
+
+            case aTypes::wait:
+                if (m_pLockId != nullptr)
+                {
+                    AddThisThreadToWaitQueue ();
+                }
+
+                if (m_nTargetTime == 0)
+                {
+                    // Indefinitely blocked, only a notification will bring it back
+                    break;
+                }
+                // fall through
+
+            case aTypes::sleep:
+                TimerArm (*this);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void atomicx::DequeueThisThread()
+    {
+        RemoveThisThreadFromRunQueue ();
+
+        if (m_flags.waitQueued == true)
+        {
+            RemoveThisThreadFromWaitQueue ();
+        }
+    }
+
+    void atomicx::RemoveThisThreadFromRunQueue()
+    {
+        switch (m_aQueue)
+        {
+            case aQueues::ready:
+            case aQueues::expired:
+                schedPolicy::Remove (*this);
+                break;
+
+            case aQueues::timer:
+                TimerCancel (*this);
+                break;
+
+            case aQueues::none:
+                break;
+        }
+
+        m_aQueue = aQueues::none;
+    }
+
+    bool atomicx::SelectNextThread()
+    {
+        for (;;)
+        {
+            atomicx_time nNow = Atomicx_GetTick();
+            atomicx_time nNext = 0;
+
+            TimerExpire (nNow);
+
+#if ATOMICX_STACK_COMPRESS
+            CompressParkedStacks (nNow);
+#endif
+
+            atomicx* pNext = schedPolicy::Select ();
+
+            if (pNext != nullptr)
+            {
+                ms_pCurrent = pNext;
+            }
+            else if (TimerNext (nNext))
+            {
+                (void) Atomicx_SleepTick(nNext > nNow ? nNext - nNow : 0);
+
+                continue;
+            }
+            else
+            {
+                // All threads are stopped or blocked in a wait without timeout, dead lock.
+                return false;
+            }
+
+            break;
+        }
+
+#if ATOMICX_STACK_COMPRESS
+        ms_pCurrent->RemoveThisThreadFromParkedList ();
+
+        if (ms_pCurrent->m_pCompressed != nullptr && ms_pCurrent->DecompressStack () == false)
+        {
+            ms_pCurrent->m_aStatus = aTypes::stackOverflow;
+
+            (void) ms_pCurrent->StackOverflowHandler();
+            abort();
+        }
+#endif
+
+        ms_pCurrent->DequeueThisThread ();
+
+        if (ms_pCurrent->m_aStatus == aTypes::wait)
+        {
+            ms_pCurrent->m_aSubStatus = aSubTypes::timeout;
+        }
+
+#if ATOMICX_DYNAMIC_NICE
+        if (ms_pCurrent->m_flags.dynamicNice == true)
+        {
+            ms_pCurrent->m_nice = ((ms_pCurrent->m_LastUserExecTime) + ms_pCurrent->m_nice) / 2;
+        }
+#endif
+
+        return true;
+    }
+
+    bool atomicx::Start(void)
+    {
+        if (ms_paFirst != nullptr)
+        {
+            ms_running = true;
+
+#if ATOMICX_STACK_COPY_KERNELS
+            // Once, unless a kernel was forced
+            if (ms_stackCopyForced == false && ms_pStackCopy != StackCopyByDepth)
+            {
+                CalibrateStackCopy ();
+            }
+#endif
+
+#if ATOMICX_DEDICATED_STACK
+            while (ms_running && SelectNextThread ())
+            {
+                if (ms_pCurrent->m_aStatus == aTypes::start && ms_pCurrent->PrepareStack () == false)
+                {
+                    (void) ms_pCurrent->StackOverflowHandler();
+                    abort();
+                }
+
+                atomicx_switch_stack (&ms_pKernelStack, ms_pCurrent->m_pStackPointer);
+
+                ReleaseStack ();
+
+                if (ms_pFinished != nullptr && IsCanaryIntact (ms_pFinished->m_stack) == false)
+                {
+                    ms_pOverflowed = ms_pFinished;
+                }
+
+                // The overflowed stack can not be trusted, the handler runs on the kernel stack
+                if (ms_pOverflowed != nullptr)
+                {
+                    (void) ms_pOverflowed->StackOverflowHandler();
+                    abort();
+                }
+
+                // finish() may delete the thread, so it is called from the kernel stack
+                if (ms_pFinished != nullptr)
+                {
+                    atomicx* pFinished = ms_pFinished;
+
+                    ms_pFinished = nullptr;
+                    pFinished->finish ();
+                }
+            }
+#else
+            // ms_selected: a yielding thread already selected a thread to be started
+            while (ms_running && (ms_selected || SelectNextThread ()))
+            {
+                ms_selected = false;
 
-            while (ms_running && SelectNextThread ())
-            {
                 if (setjmp(ms_joinContext) == 0)
                 {
-                    if (ms_pCurrent->m_aStatus == aTypes::start)
-                    {
-                        volatile uint8_t nStackStart=0;
+                    if (ms_pCurrent->m_aStatus == aTypes::start)
+                    {
+                        volatile uint8_t nStackStart=0;
+
+                        ms_pCurrent->m_aStatus = aTypes::running;
+
+                        ms_pCurrent->m_pStaskStart = &nStackStart;
+
+#if ATOMICX_TIMING_STATS
+                        ms_pCurrent->m_lastResumeUserTime = Atomicx_GetTick ();
+#endif
+
+                        ms_pCurrent->run();
+
+                        ms_pCurrent->m_aStatus = aTypes::start;
+
+                        ms_pCurrent->EnqueueThisThread ();
+
+                        ms_pCurrent->finish ();
+                    }
+                    else
+                    {
+                        longjmp(ms_pCurrent->m_context, 1);
+                    }
+                }
+            }
+#endif
+        }
+
+        ms_running = false;
+
+        return false;
+    }
+
+    bool atomicx::Yield(atomicx_time nSleep)
+    {
+        atomicx* pSelf = ms_pCurrent;
+
+#if ATOMICX_TIMING_STATS
+        pSelf->m_LastUserExecTime = GetCurrentTick () - pSelf->m_lastResumeUserTime;
+#endif
+
+        schedPolicy::Sleep (*pSelf, nSleep);
+
+        if (pSelf->m_aStatus == aTypes::running)
+        {
+            pSelf->m_aStatus = aTypes::sleep;
+            pSelf->m_aSubStatus = aSubTypes::ok;
+            pSelf->m_nTargetTime=Atomicx_GetTick() + (nSleep == ATOMICX_TIME_MAX ? pSelf->m_nice : nSleep);
+        }
+        else if (pSelf->m_aStatus == aTypes::wait)
+        {
+            pSelf->m_nTargetTime=nSleep > 0 ? nSleep + Atomicx_GetTick() : 0;
+        }
+        else if (pSelf->m_aStatus == aTypes::sleep)
+        {
+            // Absolute sleep, m_nTargetTime already set by the caller (WaitNextPeriod)
+        }
+        else
+        {
+            pSelf->m_nTargetTime = (atomicx_time)~0;
+        }
+
+        pSelf->EnqueueThisThread ();
+
+        volatile uint8_t nStackEnd=0;
+        pSelf->m_pStaskEnd = &nStackEnd;
+        pSelf->m_stacUsedkSize = static_cast<size_t>(pSelf->m_pStaskStart - pSelf->m_pStaskEnd + 1);
+
+#if ATOMICX_STACK_PROFILE
+        pSelf->ProfileStack (__builtin_return_address (0));
+#endif
+
+        /*
+         * Select the next thread before saving anything, SelectNextThread
+         * idles the CPU till a thread is due. If it is this same thread
+         * there is no context to switch, no stack to copy out and back.
+         */
+        if (ms_running == false || SelectNextThread () == false)
+        {
+            // Kernel is done (or dead lock), Start() will find it out again
+#if ATOMICX_DEDICATED_STACK
+            atomicx_switch_stack (&pSelf->m_pStackPointer, ms_pKernelStack);
+#else
+            longjmp (ms_joinContext, 1);
+#endif
+        }
+
+        if (ms_pCurrent == pSelf && pSelf->m_aStatus != aTypes::start)
+        {
+            pSelf->m_aStatus = aTypes::running;
+
+#if ATOMICX_TIMING_STATS
+            pSelf->m_lastResumeUserTime = Atomicx_GetTick ();
+#endif
+
+            return true;
+        }
+
+#if ATOMICX_DEDICATED_STACK
+        // Leave the overflowed stack for good, the kernel reports it
+        if (pSelf->m_stacUsedkSize > pSelf->m_stackSize || IsCanaryIntact (pSelf->m_stack) == false)
+        {
+            ms_pOverflowed = pSelf;
+
+            atomicx_switch_stack (&pSelf->m_pStackPointer, ms_pKernelStack);
+        }
+
+        if (ms_pCurrent->m_aStatus == aTypes::start && ms_pCurrent->PrepareStack () == false)
+        {
+            (void) ms_pCurrent->StackOverflowHandler();
+            abort();
+        }
+
+        // Nothing to copy, every thread keeps its frames on its own stack
+        atomicx_switch_stack (&pSelf->m_pStackPointer, ms_pCurrent->m_pStackPointer);
+
+        ReleaseStack ();
+
+        ms_pCurrent->m_aStatus = aTypes::running;
+
+#if ATOMICX_TIMING_STATS
+        ms_pCurrent->m_lastResumeUserTime = Atomicx_GetTick ();
+#endif
+
+        return true;
+#else
+
+        // Detached while running (Detach() or threadPool::Recycle()), it never resumes here, nothing to save
+        if (pSelf->m_flags.attached == false)
+        {
+            if (ms_pCurrent->m_aStatus == aTypes::start)
+            {
+                ms_selected = true;
+
+                longjmp(ms_joinContext, 1);
+            }
+
+            longjmp(ms_pCurrent->m_context, 1);
+        }
+
+#if ATOMICX_STACK_POOL && ! ATOMICX_STACK_ARENA
+        // Give an oversized auto stack back to the pool once usage stayed low for a while
+        if (pSelf->m_flags.autoStack == true && pSelf->m_stack != nullptr)
+        {
+            if (pSelf->m_stacUsedkSize > pSelf->m_stackSize / 4)
+            {
+                pSelf->m_nLowStackSwitches = 0;
+            }
+            else if (++pSelf->m_nLowStackSwitches >= ATOMICX_STACK_SHRINK_SWITCHES)
+            {
+                StackArenaFree (pSelf->m_stack, pSelf->m_stackSize);
+
+                pSelf->m_stack = nullptr;
+                pSelf->m_stackSize = 0;
+            }
+        }
+#endif
+
+        if (pSelf->m_stacUsedkSize > pSelf->m_stackSize || pSelf->m_stack == nullptr)
+        {
+            /*
+            * Controll the auto-stack memory
+            * Note: Due to some small microcontroller
+            *   does not have try/catch/throw by default
+            *   I decicde to use malloc/free instead
+            *   to control errors
+            */
+
+#if ATOMICX_AUTO_STACK
+            if (pSelf->m_flags.autoStack == true)
+            {
+#if ATOMICX_STACK_ARENA
+                // Released on every resume, so it is always sized to the live bytes
+                pSelf->m_stackSize = pSelf->m_stacUsedkSize;
+
+                if ((pSelf->m_stack = StackArenaAlloc (pSelf->m_stackSize)) == nullptr)
+                {
+                    pSelf->m_aStatus = aTypes::stackOverflow;
+                }
+#elif ATOMICX_STACK_POOL
+                if (pSelf->m_stack != nullptr)
+                {
+                    StackArenaFree (pSelf->m_stack, pSelf->m_stackSize);
+                }
+
+                if (pSelf->m_stacUsedkSize > pSelf->m_stackSize)
+                {
+                    // Double, but never more than ATOMICX_STACK_GROW_MAX over what is needed
+                    size_t nNeed = pSelf->m_stacUsedkSize + pSelf->m_stackIncreasePace;
+                    size_t nGrow = pSelf->m_stackSize * 2;
+
+                    if (nGrow > nNeed + ATOMICX_STACK_GROW_MAX)
+                    {
+                        nGrow = nNeed + ATOMICX_STACK_GROW_MAX;
+                    }
+
+                    pSelf->m_stackSize = nGrow > nNeed ? nGrow : nNeed;
+                }
+
+                pSelf->m_nLowStackSwitches = 0;
+
+                if ((pSelf->m_stack = StackArenaAlloc (pSelf->m_stackSize)) == nullptr)
+                {
+                    pSelf->m_aStatus = aTypes::stackOverflow;
+                }
+#else
+                if (pSelf->m_stack != nullptr)
+                {
+                    free ((void*) pSelf->m_stack);
+                }
+
+                if (pSelf->m_stacUsedkSize > pSelf->m_stackSize)
+                {
+                    pSelf->m_stackSize = pSelf->m_stacUsedkSize + pSelf->m_stackIncreasePace;
+                }
+
+                if ((pSelf->m_stack = (volatile uint8_t*) malloc (pSelf->m_stackSize)) == nullptr)
+                {
+                    pSelf->m_aStatus = aTypes::stackOverflow;
+                }
+#endif
+            }
+            else
+#endif
+            {
+                pSelf->m_aStatus = aTypes::stackOverflow;
+            }
+
+            if (pSelf->m_aStatus == aTypes::stackOverflow)
+            {
+                (void) pSelf->StackOverflowHandler();
+                abort();
+            }
+
+#if ATOMICX_STACK_INCREMENTAL
+            pSelf->m_nSavedSize = 0;
+#endif
+        }
+
+#if ATOMICX_STACK_INCREMENTAL
+        {
+            // Saved at the buffer end, so frames keep their place as the depth changes
+            volatile uint8_t* pSave = pSelf->m_stack + pSelf->m_stackSize - pSelf->m_stacUsedkSize;
+            size_t nFresh = 0;
+
+            if (pSelf->m_stacUsedkSize > pSelf->m_nSavedSize)
+            {
+                nFresh = pSelf->m_stacUsedkSize - pSelf->m_nSavedSize;
+
+                memcpy ((void*) pSave, (const void*) pSelf->m_pStaskEnd, nFresh);
+
+                ms_nStackCopied += nFresh;
+            }
+
+            CopyDirtyChunks (pSave + nFresh, pSelf->m_pStaskEnd + nFresh, pSelf->m_stacUsedkSize - nFresh);
+
+            pSelf->m_nSavedSize = pSelf->m_stacUsedkSize;
+        }
+#elif ATOMICX_STACK_COPY_KERNELS
+        ms_pStackCopy ((void*) pSelf->m_stack, (const void*) pSelf->m_pStaskEnd, pSelf->m_stacUsedkSize);
+#else
+        if (memcpy((void*)pSelf->m_stack, (const void*) pSelf->m_pStaskEnd, pSelf->m_stacUsedkSize) != (void*) pSelf->m_stack)
+        {
+            return false;
+        }
+#endif
+
+#if ATOMICX_STACK_COMPRESS
+        // A compression candidate from now on, until it is selected again
+        if (pSelf->m_flags.autoStack == true && pSelf->m_stacUsedkSize >= ms_nCompressMin)
+        {
+            pSelf->AddThisThreadToParkedList ();
+        }
+#endif
+
+        if (setjmp(pSelf->m_context) == 0)
+        {
+            if (ms_pCurrent->m_aStatus == aTypes::start)
+            {
+                // run() must begin on the base of the stack, Start() does it
+                ms_selected = true;
+
+                longjmp(ms_joinContext, 1);
+            }
+
+            // Straight to the selected thread, it restores its own stack
+            longjmp(ms_pCurrent->m_context, 1);
+        }
+        else
+        {
+#if ATOMICX_STACK_INCREMENTAL
+            // Only what other threads clobbered in the mean time
+            CopyDirtyChunks (ms_pCurrent->m_pStaskEnd, ms_pCurrent->m_stack + ms_pCurrent->m_stackSize - ms_pCurrent->m_stacUsedkSize, ms_pCurrent->m_stacUsedkSize);
+#elif ATOMICX_STACK_COPY_KERNELS
+            ms_pStackCopy ((void*) ms_pCurrent->m_pStaskEnd, (const void*) ms_pCurrent->m_stack, ms_pCurrent->m_stacUsedkSize);
+#else
+            if (memcpy((void*) ms_pCurrent->m_pStaskEnd, (const void*) ms_pCurrent->m_stack, ms_pCurrent->m_stacUsedkSize) != (void*) ms_pCurrent->m_pStaskEnd)
+            {
+                return false;
+            }
+#endif
+
+#if ATOMICX_STACK_ARENA
+            if (ms_pCurrent->m_flags.autoStack == true)
+            {
+                StackArenaFree (ms_pCurrent->m_stack, ms_pCurrent->m_stackSize);
+                ms_pCurrent->m_stack = nullptr;
+            }
+#endif
+
+            ms_pCurrent->m_aStatus = aTypes::running;
+
+#if ATOMICX_TIMING_STATS
+            ms_pCurrent->m_lastResumeUserTime = Atomicx_GetTick ();
+#endif
+        }
+
+        return true;
+#endif
+    }
+
+#if ATOMICX_DEDICATED_STACK
+    bool atomicx::PrepareStack()
+    {
+        if (m_stack == nullptr)
+        {
+            if (m_stackSize < ATOMICX_DEDICATED_STACK_SIZE)
+            {
+                m_stackSize = ATOMICX_DEDICATED_STACK_SIZE;
+            }
+
+#if ATOMICX_AUTO_STACK == 0
+            return false;
+#else
+            if ((m_stack = (volatile uint8_t*) malloc (m_stackSize)) == nullptr)
+            {
+                return false;
+            }
+#endif
+        }
+
+        // A fixed buffer sized for the stack copy would be overrun by the first call into libc
+        if (m_stackSize < ATOMICX_DEDICATED_STACK_SIZE)
+        {
+#if ATOMICX_AUTO_STACK == 0
+            return false;
+#else
+            // Runs on a heap stack instead, released with the thread like an auto stack
+            volatile uint8_t* pStack = (volatile uint8_t*) malloc (ATOMICX_DEDICATED_STACK_SIZE);
+
+            if (pStack == nullptr)
+            {
+                return false;
+            }
+
+            m_stack = pStack;
+            m_stackSize = ATOMICX_DEDICATED_STACK_SIZE;
+            m_flags.autoStack = true;
+#endif
+        }
+
+#if ATOMICX_STACK_PROFILE
+        // Once, a restarted thread keeps its high water mark
+        if (m_flags.stackPainted == false)
+        {
+            memset ((void*) m_stack, ms_nStackPaint, m_stackSize);
+
+            m_flags.stackPainted = true;
+        }
+#endif
+
+        uintptr_t nTop = ((uintptr_t) (m_stack + m_stackSize)) & ~((uintptr_t) 15);
+        void** pFrame = ((void**) nTop) - ms_nStackFrameWords;
+
+        if ((uintptr_t) pFrame < (uintptr_t) m_stack)
+        {
+            return false;
+        }
+
+        memcpy ((void*) m_stack, ms_aStackCanary, sizeof (ms_aStackCanary));
+
+        memset ((void*) pFrame, 0, ms_nStackFrameWords * sizeof (void*));
+        pFrame[ms_nStackReturnWord] = reinterpret_cast<void*> (&atomicx::StackEntry);
+
+        m_pStaskStart = (volatile uint8_t*) nTop;
+        m_pStackPointer = (void*) pFrame;
+
+        return true;
+    }
+
+    void atomicx::StackEntry()
+    {
+        ReleaseStack ();
+
+        ms_pCurrent->m_aStatus = aTypes::running;
+
+#if ATOMICX_TIMING_STATS
+        ms_pCurrent->m_lastResumeUserTime = Atomicx_GetTick ();
+#endif
+
+        ms_pCurrent->run();
+
+        ms_pCurrent->m_aStatus = aTypes::start;
+
+        ms_pCurrent->EnqueueThisThread ();
+
+        // There is no frame to return to, the kernel calls finish() and selects the next thread
+        ms_pFinished = ms_pCurrent;
+
+        atomicx_switch_stack (&ms_pCurrent->m_pStackPointer, ms_pKernelStack);
+    }
+
+    void atomicx::ReleaseStack()
+    {
+#if ATOMICX_AUTO_STACK
+        if (ms_pReleasedStack != nullptr)
+        {
+            free ((void*) ms_pReleasedStack);
+            ms_pReleasedStack = nullptr;
+        }
+#endif
+    }
+#endif
+
+#if ATOMICX_STACK_COMPRESS
+    bool atomicx::CompressStack()
+    {
+#if ATOMICX_STACK_INCREMENTAL
+        const uint8_t* pSaved = (const uint8_t*) m_stack + m_stackSize - m_stacUsedkSize;
+#else
+        const uint8_t* pSaved = (const uint8_t*) m_stack;
+#endif
+        // Must save at least a quarter
+        size_t nMax = m_stacUsedkSize - m_stacUsedkSize / 4;
+        uint8_t* pCompressed = (uint8_t*) malloc (nMax);
+        size_t nSize = 0;
+
+        if (pCompressed == nullptr)
+        {
+            return false;
+        }
+
+        if ((nSize = stackCodec::Compress (pSaved, m_stacUsedkSize, pCompressed, nMax)) == 0)
+        {
+            free (pCompressed);
+
+            return false;
+        }
+
+        // Keep only what the codec used, shrinking in place, a failed shrink keeps the whole buffer
+        if ((m_pCompressed = (uint8_t*) realloc (pCompressed, nSize)) == nullptr)
+        {
+            m_pCompressed = pCompressed;
+        }
+
+        m_nCompressedSize = nSize;
+
+        StackBufferFree (m_stack, m_stackSize);
+        m_stack = nullptr;
+
+        ms_nCompressedBytes += m_nCompressedSize;
+        ms_nUncompressedBytes += m_stacUsedkSize;
+
+        return true;
+    }
+
+    bool atomicx::DecompressStack()
+    {
+        if ((m_stack = StackBufferAlloc (m_stackSize)) == nullptr)
+        {
+            return false;
+        }
+
+#if ATOMICX_STACK_INCREMENTAL
+        uint8_t* pSaved = (uint8_t*) m_stack + m_stackSize - m_stacUsedkSize;
+#else
+        uint8_t* pSaved = (uint8_t*) m_stack;
+#endif
+
+        if (stackCodec::Decompress (m_pCompressed, m_nCompressedSize, pSaved, m_stacUsedkSize) != m_stacUsedkSize)
+        {
+            return false;
+        }
+
+        ms_nCompressedBytes -= m_nCompressedSize;
+        ms_nUncompressedBytes -= m_stacUsedkSize;
+
+        free (m_pCompressed);
+
+        m_pCompressed = nullptr;
+        m_nCompressedSize = 0;
+
+        return true;
+    }
+
+    void atomicx::CompressParkedStacks(atomicx_time nNow)
+    {
+        // Parked since its last Yield, the first one not due ends the sweep
+        while (ms_pParkedFirst != nullptr && nNow - (ms_pParkedFirst->m_lastResumeUserTime + ms_pParkedFirst->m_LastUserExecTime) >= ATOMICX_STACK_COMPRESS_AFTER)
+        {
+            atomicx* pThread = ms_pParkedFirst;
+
+            // Tried once per park, a stack the codec can not shrink waits for the next one
+            pThread->RemoveThisThreadFromParkedList ();
+
+            // Restarted threads saved a stack they will not use
+            if (pThread->m_stack != nullptr && pThread->m_aStatus != aTypes::start)
+            {
+                (void) pThread->CompressStack ();
+            }
+        }
+    }
+
+    void atomicx::AddThisThreadToParkedList()
+    {
+        RemoveThisThreadFromParkedList ();
+
+        m_pParkedNext = nullptr;
+        m_pParkedPrev = ms_pParkedLast;
+
+        if (ms_pParkedLast == nullptr)
+        {
+            ms_pParkedFirst = this;
+        }
+        else
+        {
+            ms_pParkedLast->m_pParkedNext = this;
+        }
+
+        ms_pParkedLast = this;
+    }
+
+    void atomicx::RemoveThisThreadFromParkedList()
+    {
+        if (m_pParkedPrev == nullptr && ms_pParkedFirst != this)
+        {
+            return;
+        }
+
+        if (m_pParkedPrev == nullptr)
+        {
+            ms_pParkedFirst = m_pParkedNext;
+        }
+        else
+        {
+            m_pParkedPrev->m_pParkedNext = m_pParkedNext;
+        }
+
+        if (m_pParkedNext == nullptr)
+        {
+            ms_pParkedLast = m_pParkedPrev;
+        }
+        else
+        {
+            m_pParkedNext->m_pParkedPrev = m_pParkedPrev;
+        }
+
+        m_pParkedNext = nullptr;
+        m_pParkedPrev = nullptr;
+    }
+#endif
+
+    bool atomicx::IsKernelRunning()
+    {
+        return ms_running;
+    }
+
+    void atomicx::YieldNow ()
+    {
+        m_aStatus = aTypes::now;
+        m_aSubStatus = aSubTypes::ok;
+        EnqueueThisThread ();
+
+        Yield ();
+    }
+
+    atomicx_time atomicx::GetNice(void)
+    {
+        return m_nice;
+    }
+
+    size_t atomicx::GetStackSize(void)
+    {
+        return m_stackSize;
+    }
+
+    size_t atomicx::GetUsedStackSize(void)
+    {
+        return m_stacUsedkSize;
+    }
+
+#if ATOMICX_STACK_PROFILE
+    void atomicx::ProfileStack(void* pSite)
+    {
+        uint8_t nBucket = 0;
+
+        if (m_stacUsedkSize > m_nMaxUsedStack)
+        {
+            m_nMaxUsedStack = m_stacUsedkSize;
+            m_pMaxUsedSite = pSite;
+        }
+
+        for (size_t nSize = m_stacUsedkSize >> 7; nSize > 0 && nBucket < ms_nStackHistogram - 1; nSize >>= 1)
+        {
+            nBucket++;
+        }
+
+        m_aStackHistogram[nBucket]++;
+    }
+
+    size_t atomicx::GetMaxUsedStackSize(void)
+    {
+#if ATOMICX_DEDICATED_STACK
+        if (m_flags.stackPainted == true)
+        {
+            volatile uint8_t* pTouched = m_stack + sizeof (ms_aStackCanary);
+
+            while (pTouched < m_pStaskStart && *pTouched == ms_nStackPaint)
+            {
+                pTouched++;
+            }
+
+            if ((size_t) (m_pStaskStart - pTouched) > m_nMaxUsedStack)
+            {
+                return (size_t) (m_pStaskStart - pTouched);
+            }
+        }
+#endif
+        return m_nMaxUsedStack;
+    }
+
+    void* atomicx::GetMaxUsedStackSite(void)
+    {
+        return m_pMaxUsedSite;
+    }
+
+    void atomicx::StackProfileReport(void (*pWrite)(const char* pszText))
+    {
+        char szLine[160];
+
+        snprintf (szLine, sizeof (szLine), "/* atomicx stack profile, recommended sizes are the high water mark + %u%% */\n", (unsigned) ATOMICX_STACK_PROFILE_MARGIN);
+        pWrite (szLine);
+
+        for (atomicx* pThread = ms_paFirst; pThread != nullptr; pThread = pThread->m_paNext)
+        {
+            size_t nSwitches = 0;
+
+            for (uint8_t nBucket = 0; nBucket < ms_nStackHistogram; nBucket++)
+            {
+                nSwitches += pThread->m_aStackHistogram[nBucket];
+            }
+
+            snprintf (szLine, sizeof (szLine), "\n/* %s (id %zu): high water %zu bytes, Yield call site %p, %zu switches\n",
+                      pThread->GetName (), pThread->GetID (), pThread->GetMaxUsedStackSize (), pThread->m_pMaxUsedSite, nSwitches);
+            pWrite (szLine);
+
+            for (uint8_t nBucket = 0; nBucket < ms_nStackHistogram; nBucket++)
+            {
+                if (pThread->m_aStackHistogram[nBucket] == 0)
+                {
+                    continue;
+                }
+
+                if (nBucket < ms_nStackHistogram - 1)
+                {
+                    snprintf (szLine, sizeof (szLine), " *   < %6zu bytes: %lu\n", (size_t) 128 << nBucket, (unsigned long) pThread->m_aStackHistogram[nBucket]);
+                }
+                else
+                {
+                    snprintf (szLine, sizeof (szLine), " *  >= %6zu bytes: %lu\n", (size_t) 64 << nBucket, (unsigned long) pThread->m_aStackHistogram[nBucket]);
+                }
+
+                pWrite (szLine);
+            }
+
+            pWrite (" */\n");
+
+            // One define per name, with the biggest thread of that name
+            atomicx* pFirst = ms_paFirst;
+            size_t nMax = 0;
+
+            while (pFirst != pThread && strcmp (pFirst->GetName (), pThread->GetName ()) != 0)
+            {
+                pFirst = pFirst->m_paNext;
+            }
+
+            if (pFirst != pThread)
+            {
+                continue;
+            }
+
+            for (atomicx* pSame = pThread; pSame != nullptr; pSame = pSame->m_paNext)
+            {
+                if (strcmp (pSame->GetName (), pThread->GetName ()) == 0 && pSame->GetMaxUsedStackSize () > nMax)
+                {
+                    nMax = pSame->GetMaxUsedStackSize ();
+                }
+            }
+
+            nMax += nMax * ATOMICX_STACK_PROFILE_MARGIN / 100;
+            nMax = (nMax + 15) & ~((size_t) 15);
+
+            size_t nLength = (size_t) snprintf (szLine, sizeof (szLine), "#define ATOMICX_STACK_SIZE_%.64s", pThread->GetName ());
+
+            // Name as an identifier
+            for (char* pChar = szLine + sizeof ("#define ATOMICX_STACK_SIZE_") - 1; *pChar != '\0'; pChar++)
+            {
+                if (! ((*pChar >= 'a' && *pChar <= 'z') || (*pChar >= 'A' && *pChar <= 'Z') || (*pChar >= '0' && *pChar <= '9')))
+                {
+                    *pChar = '_';
+                }
+            }
+
+            snprintf (szLine + nLength, sizeof (szLine) - nLength, " %zu\n", nMax);
+            pWrite (szLine);
+        }
+    }
+#endif
+
+    void atomicx::SetDefaultInitializations ()
+    {
+        m_flags.attached = true;
+        
+        AddThisThread();
+        EnqueueThisThread();
+    }
+
+#if ATOMICX_AUTO_STACK
+    atomicx::atomicx(size_t nStackSize, int nStackIncreasePace) : m_context{}, m_stackSize(nStackSize), m_stackIncreasePace(nStackIncreasePace), m_stack(nullptr)
+    {
+        SetDefaultInitializations ();
+
+        m_flags.autoStack = true;
+
+    }
+#endif
+
+    void atomicx::DestroyThread()
+    {
+        if (m_flags.attached)
+        {
+            DequeueThisThread();
+            RemoveThisThread();
+
+            m_flags.attached = false;
+        }
+
+        // Also for threads detached before (threadPool keeps their stacks)
+#if ATOMICX_AUTO_STACK
+        if (m_flags.autoStack == true && m_stack != nullptr)
+        {
+#if ATOMICX_DEDICATED_STACK
+            // The CPU may still be running on it, free after the next switch
+            if (this == ms_pCurrent)
+            {
+                ReleaseStack ();
+                ms_pReleasedStack = m_stack;
+            }
+            else
+#endif
+            {
+#if ATOMICX_STACK_ARENA || ATOMICX_STACK_POOL
+                StackArenaFree (m_stack, m_stackSize);
+#else
+                free((void*)m_stack);
+#endif
+            }
+
+            m_stack = nullptr;
+        }
+#endif
+
+#if ATOMICX_STACK_COMPRESS
+        if (m_pCompressed != nullptr)
+        {
+            ms_nCompressedBytes -= m_nCompressedSize;
+            ms_nUncompressedBytes -= m_stacUsedkSize;
+
+            free (m_pCompressed);
+            m_pCompressed = nullptr;
+        }
+#endif
+    }
+
+    void atomicx::RecycleThread()
+    {
+        if (m_flags.attached)
+        {
+            DequeueThisThread();
+            RemoveThisThread();
+
+            m_flags.attached = false;
+        }
+    }
+
+    void atomicx::RearmThread()
+    {
+        m_aStatus = aTypes::start;
+        m_aSubStatus = aSubTypes::ok;
+        m_pLockId = nullptr;
+        m_nTargetTime = 0;
+        m_lockMessage = {0,0};
+
+        // Kernel state back to the defaults of a new thread, T::Rearm() sets its own again
+        m_nPriority = 0;
+        m_nBasePriority = 0;
+        m_pHeldLocks = nullptr;
+        m_pBlockedBy = nullptr;
+
+        m_nice = 0;
+#if ATOMICX_DYNAMIC_NICE
+        m_flags.dynamicNice = false;
+#endif
+#if ATOMICX_BROADCAST
+        m_flags.broadcast = false;
+#endif
+#if ATOMICX_PAYLOAD_SIZE
+        m_flags.payloadReceived = false;
+#endif
+
+        m_nDeadline = 0;
+        m_nPeriod = 0;
+        m_nRelativeDeadline = 0;
+        m_nRelease = 0;
+        m_nMaxLateness = 0;
+        m_nTotalLateness = 0;
+        m_nJobs = 0;
+        m_nDeadlineMisses = 0;
+
+#if ATOMICX_SCHED_FAIR
+        m_nVirtualRuntime = 0;
+        m_nShare = ATOMICX_FAIR_SHARE;
+#endif
+
+#if ATOMICX_TIMING_STATS
+        m_LastUserExecTime = 0;
+        m_lastResumeUserTime = 0;
+#endif
+
+        m_flags.attached = true;
 
-                        ms_pCurrent->m_aStatus = aTypes::running;
+        AddThisThread ();
+        EnqueueThisThread ();
+    }
+
+    void atomicx::finish() noexcept
+    {
+        return;
+    }
+
+    void atomicx::Detach()
+    {
+        this->finish ();
+
+        // finish() may have given it to a threadPool, which keeps the stack
+        if (m_flags.attached)
+        {
+            DestroyThread ();
+        }
+
+        Yield ();
+    }
+
+    void atomicx::Restart()
+    {
+        this->finish ();
+        m_aStatus = aTypes::start;
+        EnqueueThisThread ();
+
+        Yield ();
+    }
+
+    atomicx::~atomicx()
+    {
+        DestroyThread ();
+    }
+
+    const char* atomicx::GetName(void)
+    {
+        return "thread";
+    }
+
+    void atomicx::SetNice (atomicx_time nice)
+    {
+        m_nice = nice;
+    }
+
+    size_t atomicx::GetID(void)
+    {
+        return (size_t) this;
+    }
+
+    atomicx::Handle atomicx::GetHandle(void)
+    {
+        if (m_nSlot == ms_nNoSlot)
+        {
+            return {ms_nNoSlot, 0};
+        }
+
+        return {m_nSlot, ms_aSlots[m_nSlot].nGeneration};
+    }
+
+    atomicx_time atomicx::GetTargetTime(void)
+    {
+        return m_nTargetTime;
+    }
+
+    int atomicx::GetStatus(void)
+    {
+        return static_cast<int>(m_aStatus);
+    }
+
+    int atomicx::GetSubStatus(void)
+    {
+        return static_cast<int>(m_aSubStatus);
+    }
+
+    size_t atomicx::GetReferenceLock(void)
+    {
+        return (size_t) m_pLockId;
+    }
+
+    size_t atomicx::GetTagLock(void)
+    {
+        return (size_t) m_lockMessage.tag;
+    }
+
+    bool atomicx::mutex::Lock(atomicx_time ttimeout)
+    {
+        Timeout timeout(ttimeout);
+
+        auto pAtomic = atomicx::GetCurrent();
+
+        if(pAtomic == nullptr) return false;
+
+        // Get exclusive mutex, lending our priority to its holder meanwhile
+        while (bExclusiveLock)
+        {
+            // Once the deadline passed the remaining time is 0, which would wait forever
+            atomicx_time nRemaining = timeout.GetRemaining();
+
+            if (ttimeout > 0 && nRemaining == 0) return false;
+
+            if (m_pOwner != nullptr) pAtomic->LockWaitStarted (m_pOwner);
+
+            bool bNotified = pAtomic->Wait(bExclusiveLock, 1, nRemaining);
+
+            pAtomic->LockWaitEnded ();
+
+            if  (! bNotified) return false;
+        }
+
+        bExclusiveLock = true;
+        m_pOwner = pAtomic;
+        pAtomic->LockAcquired (m_held);
+
+        // Wait all shared locks to be done
+        while (nSharedLockCount)
+        {
+            atomicx_time nRemaining = timeout.GetRemaining();
+
+            if ((ttimeout > 0 && nRemaining == 0) || ! pAtomic->Wait(nSharedLockCount,2, nRemaining))
+            {
+                // Give the exclusive lock back, its owner accounting and the waiters with it
+                Unlock ();
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void atomicx::mutex::Unlock()
+    {
+        auto pAtomic = atomicx::GetCurrent();
+
+        if(pAtomic == nullptr) return;
+
+        if (bExclusiveLock == true)
+        {
+            bExclusiveLock = false;
+
+            if (m_pOwner != nullptr)
+            {
+                m_pOwner->LockReleased (m_held);
+                m_pOwner = nullptr;
+            }
+
+            // Notify Other locks procedures
+            pAtomic->Notify(nSharedLockCount, 2, NotifyType::all);
+            pAtomic->Notify(bExclusiveLock, 1, NotifyType::one);
+        }
+    }
+
+    bool atomicx::mutex::SharedLock(atomicx_time ttimeout)
+    {
+        Timeout timeout(ttimeout);
+        auto pAtomic = atomicx::GetCurrent();
+
+        if(pAtomic == nullptr) return false;
+
+        // Wait for exclusive mutex
+        while (bExclusiveLock > 0)
+        {
+            atomicx_time nRemaining = timeout.GetRemaining();
+
+            if ((ttimeout > 0 && nRemaining == 0) || ! pAtomic->Wait(bExclusiveLock, 1, nRemaining)) return false;
+        }
+
+        nSharedLockCount++;
+
+        // Notify Other locks procedures
+        pAtomic->Notify (nSharedLockCount, 2, NotifyType::one);
+
+        return true;
+    }
+
+    void atomicx::mutex::SharedUnlock()
+    {
+        auto pAtomic = atomicx::GetCurrent();
+
+        if(pAtomic == nullptr) return;
+
+        if (nSharedLockCount)
+        {
+            nSharedLockCount--;
+
+            pAtomic->Notify(nSharedLockCount, 2, NotifyType::one);
+        }
+    }
+
+    size_t atomicx::mutex::IsShared()
+    {
+        return nSharedLockCount;
+    }
+
+    bool atomicx::mutex::IsLocked()
+    {
+        return bExclusiveLock;
+    }
+
+    atomicx::smartMutex::smartMutex (mutex& lockObj) : m_lock(lockObj)
+    {}
+
+    atomicx::smartMutex::~smartMutex()
+    {
+        switch (m_lockType)
+        {
+            case 'L':
+                m_lock.Unlock();
+                break;
+            case 'S':
+                m_lock.SharedUnlock();
+                break;
+        }
+    }
+
+    bool atomicx::smartMutex::SharedLock(atomicx_time ttimeout)
+    {
+        bool bRet = false;
+
+        if (m_lockType == '\0')
+        {
+            if (m_lock.SharedLock(ttimeout))
+            {
+                m_lockType = 'S';
+                bRet = true;
+            }
+        }
+
+        return bRet;
+    }
+
+    bool atomicx::smartMutex::Lock(atomicx_time ttimeout)
+    {
+        bool bRet = false;
+
+        if (m_lockType == '\0')
+        {
+            if (m_lock.Lock(ttimeout))
+            {
+                m_lockType = 'L';
+                bRet = true;
+            }
+        }
+
+        return bRet;
+    }
+
+    size_t atomicx::smartMutex::IsShared()
+    {
+        return m_lock.IsShared();
+    }
+
+    bool atomicx::smartMutex::IsLocked()
+    {
+        return m_lock.IsLocked();
+    }
+
+    uint16_t atomicx::crc16(const uint8_t* pData, size_t nSize, uint16_t nCRC)
+    {
+        #define POLY 0x8408
+        unsigned char nCount;
+        unsigned int data;
+
+        nCRC = ~nCRC;
+
+        if (nSize == 0) return (~nCRC);
+
+        do
+        {
+            for (nCount = 0, data = (unsigned int)0xff & *pData++; nCount < 8; nCount++, data >>= 1)
+            {
+                if ((nCRC & 0x0001) ^ (data & 0x0001))
+                    nCRC = (nCRC >> 1) ^ POLY;
+                else
+                    nCRC >>= 1;
+            }
+        } while (--nSize);
+
+        nCRC = ~nCRC;
+        data = nCRC;
+        nCRC = (nCRC << 8) | (data >> 8 & 0xff);
+
+        return (nCRC);
+    }
 
-                        ms_pCurrent->m_pStaskStart = &nStackStart;
+    atomicx_time atomicx::GetCurrentTick(void)
+    {
+        return Atomicx_GetTick ();
+    }
 
-                        ms_pCurrent->m_lastResumeUserTime = Atomicx_GetTick ();
+    bool atomicx::IsStackSelfManaged(void)
+    {
+#if ATOMICX_AUTO_STACK
+        return m_flags.autoStack;
+#else
+        return false;
+#endif
+    }
 
-                        ms_pCurrent->run();
+#if ATOMICX_TIMING_STATS
+    atomicx_time atomicx::GetLastUserExecTime()
+    {
+        return m_LastUserExecTime;
+    }
+#endif
 
-                        ms_pCurrent->m_aStatus = aTypes::start;
+#if ATOMICX_AUTO_STACK
+    void atomicx::SetStackIncreasePace(size_t nIncreasePace)
+    {
+        m_stackIncreasePace = nIncreasePace;
+    }
 
-                        ms_pCurrent->finish ();
-                    }
-                    else
-                    {
-                        longjmp(ms_pCurrent->m_context, 1);
-                    }
-                }
-            }
-        }
+    size_t atomicx::GetStackIncreasePace(void)
+    {
+        return m_stackIncreasePace;
+    }
+#endif
 
-        ms_running = false;
+#if ATOMICX_DYNAMIC_NICE
+    void atomicx::SetDynamicNice(bool status)
+    {
+        m_flags.dynamicNice = status;
+    }
 
-        return false;
+    bool atomicx::IsDynamicNiceOn()
+    {
+        return m_flags.dynamicNice;
     }
+#endif
 
-    bool atomicx::Yield(atomicx_time nSleep)
+    void atomicx::SetPriority(uint8_t nPriority)
     {
-        ms_pCurrent->m_LastUserExecTime = GetCurrentTick () - ms_pCurrent->m_lastResumeUserTime;
+        m_nBasePriority = nPriority < ATOMICX_PRIORITIES ? nPriority : ATOMICX_PRIORITIES - 1;
 
-        if (ms_pCurrent->m_aStatus == aTypes::running)
+        // Never drop below a priority inherited from a lock waiter, and pass a raise down the lock chain
+        if (m_nBasePriority > m_nPriority)
         {
-            ms_pCurrent->m_aStatus = aTypes::sleep;
-            ms_pCurrent->m_aSubStatus = aSubTypes::ok;
-            ms_pCurrent->m_nTargetTime=Atomicx_GetTick() + (nSleep == ATOMICX_TIME_MAX ? ms_pCurrent->m_nice : nSleep);
+            InheritPriority (m_nBasePriority);
         }
-        else if (ms_pCurrent->m_aStatus == aTypes::wait)
+        else
         {
-            ms_pCurrent->m_nTargetTime=nSleep > 0 ? nSleep + Atomicx_GetTick() : 0;
+            RecomputePriority ();
         }
-        else
+    }
+
+    uint8_t atomicx::GetPriority()
+    {
+        return m_nPriority;
+    }
+
+    uint8_t atomicx::GetBasePriority()
+    {
+        return m_nBasePriority;
+    }
+
+    void atomicx::SetEffectivePriority(uint8_t nPriority)
+    {
+        if (nPriority == m_nPriority)
         {
-            ms_pCurrent->m_nTargetTime = (atomicx_time)~0;
+            return;
         }
 
-        volatile uint8_t nStackEnd=0;
-        ms_pCurrent->m_pStaskEnd = &nStackEnd;
-        ms_pCurrent->m_stacUsedkSize = static_cast<size_t>(ms_pCurrent->m_pStaskStart - ms_pCurrent->m_pStaskEnd + 1);
+        aQueues aQueue = m_aQueue;
 
-        if (ms_pCurrent->m_stacUsedkSize > ms_pCurrent->m_stackSize || ms_pCurrent->m_stack == nullptr)
+        if (aQueue == aQueues::ready || aQueue == aQueues::expired)
         {
-            /*
-            * Controll the auto-stack memory
-            * Note: Due to some small microcontroller
-            *   does not have try/catch/throw by default
-            *   I decicde to use malloc/free instead
-            *   to control errors
-            */
+            RemoveThisThreadFromRunQueue ();
+        }
 
-            if (ms_pCurrent->m_flags.autoStack == true)
-            {
-                if (ms_pCurrent->m_stack != nullptr)
-                {
-                    free ((void*) ms_pCurrent->m_stack);
-                }
+        m_nPriority = nPriority;
 
-                if (ms_pCurrent->m_stacUsedkSize > ms_pCurrent->m_stackSize)
-                {
-                    ms_pCurrent->m_stackSize = ms_pCurrent->m_stacUsedkSize + ms_pCurrent->m_stackIncreasePace;
-                }
+        if (aQueue == aQueues::ready)
+        {
+            PushReadyQueue (*this);
+        }
+        else if (aQueue == aQueues::expired)
+        {
+            PushExpiredQueue (*this);
+        }
+    }
 
-                if ((ms_pCurrent->m_stack = (volatile uint8_t*) malloc (ms_pCurrent->m_stackSize)) == nullptr)
-                {
-                    ms_pCurrent->m_aStatus = aTypes::stackOverflow;
-                }
-            }
-            else
-            {
-                ms_pCurrent->m_aStatus = aTypes::stackOverflow;
-            }
+    void atomicx::SetPeriod(atomicx_time nPeriod, atomicx_time nDeadline)
+    {
+        aQueues aQueue = m_aQueue;
 
-            if (ms_pCurrent->m_aStatus == aTypes::stackOverflow)
-            {
-                (void) ms_pCurrent->StackOverflowHandler();
-                abort();
-            }
+        // The policy may order threads by period or deadline, leave it while they change
+        if (aQueue == aQueues::ready || aQueue == aQueues::expired)
+        {
+            RemoveThisThreadFromRunQueue ();
         }
 
-        if (ms_pCurrent->m_aStatus != aTypes::stackOverflow && memcpy((void*)ms_pCurrent->m_stack, (const void*) ms_pCurrent->m_pStaskEnd, ms_pCurrent->m_stacUsedkSize) != (void*) ms_pCurrent->m_stack)
+        m_nPeriod = nPeriod;
+        m_nRelativeDeadline = nDeadline > 0 ? nDeadline : nPeriod;
+        m_nRelease = Atomicx_GetTick ();
+        m_nDeadline = m_nRelease + m_nRelativeDeadline;
+
+        if (aQueue == aQueues::expired)
         {
-            return false;
+            PushExpiredQueue (*this);
         }
+        else if (aQueue == aQueues::ready)
+        {
+            PushReadyQueue (*this);
+        }
+    }
+
+    atomicx_time atomicx::GetPeriod()
+    {
+        return m_nPeriod;
+    }
+
+    atomicx_time atomicx::GetDeadline()
+    {
+        return m_nDeadline;
+    }
 
-        if (setjmp(ms_pCurrent->m_context) == 0)
+    bool atomicx::WaitNextPeriod()
+    {
+        if (m_nPeriod == 0 || ms_pCurrent != this)
         {
-            longjmp(ms_joinContext, 1);
+            return false;
         }
-        else
+
+        atomicx_time nNow = Atomicx_GetTick ();
+        bool bMet = true;
+
+        m_nJobs++;
+
+        if (nNow > m_nDeadline)
         {
-            if (memcpy((void*) ms_pCurrent->m_pStaskEnd, (const void*) ms_pCurrent->m_stack, ms_pCurrent->m_stacUsedkSize) != (void*) ms_pCurrent->m_pStaskEnd)
+            atomicx_time nLateness = nNow - m_nDeadline;
+
+            m_nDeadlineMisses++;
+            m_nTotalLateness += nLateness;
+
+            if (nLateness > m_nMaxLateness)
             {
-                return false;
+                m_nMaxLateness = nLateness;
             }
 
-            ms_pCurrent->m_aStatus = aTypes::running;
-
-            ms_pCurrent->m_lastResumeUserTime = Atomicx_GetTick ();
+            bMet = false;
         }
 
-        return true;
+        // Next release is always relative to the previous one, never to now
+        m_nRelease += m_nPeriod;
+        m_nDeadline = m_nRelease + m_nRelativeDeadline;
+
+        m_aStatus = aTypes::sleep;
+        m_aSubStatus = aSubTypes::ok;
+        m_nTargetTime = m_nRelease;
+
+        Yield ();
+
+        return bMet;
     }
 
-    bool atomicx::IsKernelRunning()
+    size_t atomicx::GetJobCount()
     {
-        return ms_running;
+        return m_nJobs;
     }
 
-    void atomicx::YieldNow ()
+    size_t atomicx::GetDeadlineMisses()
     {
-        m_aStatus = aTypes::now;
-        m_aSubStatus = aSubTypes::ok;
-        Yield ();
+        return m_nDeadlineMisses;
     }
 
-    atomicx_time atomicx::GetNice(void)
+    atomicx_time atomicx::GetMaxLateness()
     {
-        return m_nice;
+        return m_nMaxLateness;
     }
 
-    size_t atomicx::GetStackSize(void)
+    atomicx_time atomicx::GetTotalLateness()
     {
-        return m_stackSize;
+        return m_nTotalLateness;
     }
 
-    size_t atomicx::GetUsedStackSize(void)
+#if ATOMICX_SCHED_FAIR
+    void atomicx::SetShare(size_t nShare)
     {
-        return m_stacUsedkSize;
+        m_nShare = nShare > 0 ? nShare : 1;
     }
 
-    void atomicx::SetDefaultInitializations ()
+    size_t atomicx::GetShare()
     {
-        m_flags.autoStack = false;
-        m_flags.dynamicNice = false;
-        m_flags.broadcast = false;
-        m_flags.attached = true;
-        
-        AddThisThread();
+        return m_nShare;
     }
 
-    atomicx::atomicx(size_t nStackSize, int nStackIncreasePace) : m_context{}, m_stackSize(nStackSize), m_stackIncreasePace(nStackIncreasePace), m_stack(nullptr)
+    atomicx_time atomicx::GetVirtualRuntime()
     {
-        SetDefaultInitializations ();
+        return m_nVirtualRuntime;
+    }
+#endif
 
-        m_flags.autoStack = true;
+    void atomicx::InheritPriority(uint8_t nPriority)
+    {
+        // Stops at the first holder already that high, so a deadlock cycle ends too
+        for (atomicx* pHolder = this; pHolder != nullptr && nPriority > pHolder->m_nPriority; pHolder = pHolder->m_pBlockedBy)
+        {
+            pHolder->SetEffectivePriority (nPriority);
+        }
+    }
+
+    void atomicx::RecomputePriority()
+    {
+        // Each step lowers a priority, so a deadlock cycle ends too
+        for (atomicx* pHolder = this; pHolder != nullptr; pHolder = pHolder->m_pBlockedBy)
+        {
+            uint8_t nPriority = pHolder->GetInheritedPriority (pHolder->m_nBasePriority);
+
+            if (nPriority >= pHolder->m_nPriority)
+            {
+                break;
+            }
 
+            pHolder->SetEffectivePriority (nPriority);
+        }
     }
 
-    void atomicx::DestroyThread()
+    void atomicx::LockWaitStarted(atomicx* pOwner)
     {
-        if (m_flags.attached)
+        m_pBlockedBy = pOwner;
+
+        pOwner->InheritPriority (m_nPriority);
+    }
+
+    void atomicx::LockWaitEnded()
+    {
+        atomicx* pHolder = m_pBlockedBy;
+
+        m_pBlockedBy = nullptr;
+
+        // Only a boosted holder this waiter may have boosted can drop
+        if (pHolder != nullptr && pHolder->m_nPriority > pHolder->m_nBasePriority && m_nPriority >= pHolder->m_nPriority)
         {
-            RemoveThisThread();
+            pHolder->RecomputePriority ();
+        }
+    }
 
-            if (m_flags.autoStack == true && m_stack != nullptr)
+    uint8_t atomicx::GetInheritedPriority(uint8_t nPriority)
+    {
+        // Only the waiters of the held locks, not every thread
+        for (heldLock* pLock = m_pHeldLocks; pLock != nullptr; pLock = pLock->pNext)
+        {
+            for (atomicx* pWaiter = GetWaitQueue (pLock->pLockId); pWaiter != nullptr; pWaiter = pWaiter->m_pWaitNext)
             {
-                free((void*)m_stack);
+                if (pWaiter->m_pBlockedBy == this && pWaiter->m_nPriority > nPriority)
+                {
+                    nPriority = pWaiter->m_nPriority;
+                }
             }
+        }
 
-            m_flags.attached = false;
+        return nPriority;
+    }
+
+    void atomicx::LockAcquired(heldLock& lock)
+    {
+        lock.pNext = m_pHeldLocks;
+        m_pHeldLocks = &lock;
+    }
+
+    void atomicx::LockReleased(heldLock& lock)
+    {
+        for (heldLock** ppLock = &m_pHeldLocks; *ppLock != nullptr; ppLock = &(*ppLock)->pNext)
+        {
+            if (*ppLock == &lock)
+            {
+                *ppLock = lock.pNext;
+                lock.pNext = nullptr;
+
+                break;
+            }
+        }
+
+        // Its waiters no longer count, the other held locks still do
+        if (m_nPriority > m_nBasePriority)
+        {
+            RecomputePriority ();
         }
     }
 
-    void atomicx::finish() noexcept
+    atomicx* atomicx::GetThread(size_t threadId)
     {
-        return;
+        for (auto& th : *(thread::atomicx::GetCurrent()))
+        {
+            if (reinterpret_cast<size_t>(&th) == threadId)
+            {
+                return &th;
+            }
+        }
+
+        return nullptr;
     }
 
-    void atomicx::Detach()
+    atomicx* atomicx::GetThread(Handle handle)
     {
-        this->finish ();
-        DestroyThread ();
+        if (handle.index < ms_nSlotsUsed && ms_aSlots[handle.index].nGeneration == handle.generation)
+        {
+            return ms_aSlots[handle.index].pThread;
+        }
 
-        Yield ();
+        return nullptr;
     }
 
-    void atomicx::Restart()
+    atomicx& atomicx::GetThread (void)
     {
-       this->finish ();
-        m_aStatus = aTypes::start;
+        return *this;
+    }
 
-        Yield ();
+    size_t  atomicx::GetThreadCount()
+    {
+        return ms_nThreadCount;
     }
 
-    atomicx::~atomicx()
+#if ATOMICX_BROADCAST
+    void atomicx::SetReceiveBroadcast (bool bBroadcastStatus)
     {
-        DestroyThread ();
+        m_flags.broadcast = bBroadcastStatus;
     }
 
-    const char* atomicx::GetName(void)
+    size_t atomicx::BroadcastMessage (const size_t messageReference, const Message message)
     {
-        return "thread";
+        size_t nReceived = 0;
+
+        for (auto& thr : *this)
+        {
+            if (thr.m_flags.broadcast == true)
+            {
+                thr.BroadcastHandler (messageReference, message);
+                nReceived++;
+            }
+        }
+
+        return nReceived;
     }
 
-    void atomicx::SetNice (atomicx_time nice)
+    void atomicx::BroadcastHandler (const size_t& messageReference, const Message& message)
     {
-        m_nice = nice;
+        (void) messageReference; // to avoid unused variable
+        (void) message; // to avoid unused variable
     }
+#endif
 
-    size_t atomicx::GetID(void)
+    void atomicx::Stop ()
     {
-        return (size_t) this;
+        m_aStatus = aTypes::stop;
+        m_aSubStatus = aSubTypes::none;
+        m_nTargetTime = 0;
+        DequeueThisThread();
+
+        Yield();
     }
 
-    atomicx_time atomicx::GetTargetTime(void)
+    void atomicx::Resume ()
+    {
+        m_aStatus = aTypes::now;
+        m_aSubStatus = aSubTypes::ok;
+        m_nTargetTime = 0;
+        EnqueueThisThread();
+
+        Yield();
+    }
+
+    bool atomicx::IsStopped ()
+    {
+        return  m_aStatus == aTypes::stop;
+    }
+
+
+    /*
+     * Scheduler policies
+     */
+
+    // Round robin
+    atomicx* policy::roundRobin::ms_pReadyFirst=nullptr;
+    atomicx* policy::roundRobin::ms_pReadyLast=nullptr;
+    atomicx* policy::roundRobin::ms_pExpiredFirst=nullptr;
+    atomicx* policy::roundRobin::ms_pExpiredLast=nullptr;
+
+    void policy::roundRobin::Ready(atomicx& thr)
     {
-        return m_nTargetTime;
+        PushFifo (ms_pReadyFirst, ms_pReadyLast, thr);
     }
 
-    int atomicx::GetStatus(void)
+    void policy::roundRobin::Expired(atomicx& thr)
     {
-        return static_cast<int>(m_aStatus);
+        PushFifo (ms_pExpiredFirst, ms_pExpiredLast, thr);
     }
 
-    int atomicx::GetSubStatus(void)
+    void policy::roundRobin::Remove(atomicx& thr)
     {
-        return static_cast<int>(m_aSubStatus);
+        if (IsExpired (thr))
+        {
+            RemoveFifo (ms_pExpiredFirst, ms_pExpiredLast, thr);
+        }
+        else
+        {
+            RemoveFifo (ms_pReadyFirst, ms_pReadyLast, thr);
+        }
     }
 
-    size_t atomicx::GetReferenceLock(void)
+    atomicx* policy::roundRobin::Select()
     {
-        return (size_t) m_pLockId;
+        return ms_pReadyFirst != nullptr ? ms_pReadyFirst : ms_pExpiredFirst;
     }
 
-    size_t atomicx::GetTagLock(void)
+    void policy::roundRobin::Sleep(atomicx& thr, atomicx_time& nSleep)
     {
-        return (size_t) m_lockMessage.tag;
+        (void) thr;
+        (void) nSleep;
     }
 
-    bool atomicx::mutex::Lock(atomicx_time ttimeout)
+    // Fixed priority
+    static_assert (ATOMICX_PRIORITIES >= 1 && ATOMICX_PRIORITIES <= 32, "ATOMICX_PRIORITIES must be between 1 and 32");
+
+    atomicx* policy::priority::ms_paReadyFirst[ATOMICX_PRIORITIES]{};
+    atomicx* policy::priority::ms_paReadyLast[ATOMICX_PRIORITIES]{};
+    atomicx* policy::priority::ms_paExpiredFirst[ATOMICX_PRIORITIES]{};
+    atomicx* policy::priority::ms_paExpiredLast[ATOMICX_PRIORITIES]{};
+    uint32_t policy::priority::ms_readyMap=0;
+    uint32_t policy::priority::ms_expiredMap=0;
+
+    static inline uint8_t HighestPriority(uint32_t nMap)
     {
-        Timeout timeout(ttimeout);
+#if defined(__GNUC__)
+        return (uint8_t) (31 - __builtin_clz (nMap));
+#else
+        uint8_t nPriority = 0;
 
-        auto pAtomic = atomicx::GetCurrent();
+        while (nMap >>= 1)
+        {
+            nPriority++;
+        }
 
-        if(pAtomic == nullptr) return false;
+        return nPriority;
+#endif
+    }
 
-        // Get exclusive mutex
-        while (bExclusiveLock) if  (! pAtomic->Wait(bExclusiveLock, 1, timeout.GetRemaining())) return false;
+    void policy::priority::Ready(atomicx& thr)
+    {
+        uint8_t nPriority = thr.GetPriority ();
 
-        bExclusiveLock = true;
+        PushFifo (ms_paReadyFirst[nPriority], ms_paReadyLast[nPriority], thr);
+        ms_readyMap |= ((uint32_t) 1) << nPriority;
+    }
 
-        // Wait all shared locks to be done
-        while (nSharedLockCount) if (! pAtomic->Wait(nSharedLockCount,2, timeout.GetRemaining())) return false;
+    void policy::priority::Expired(atomicx& thr)
+    {
+        uint8_t nPriority = thr.GetPriority ();
 
-        return true;
+        PushFifo (ms_paExpiredFirst[nPriority], ms_paExpiredLast[nPriority], thr);
+        ms_expiredMap |= ((uint32_t) 1) << nPriority;
     }
 
-    void atomicx::mutex::Unlock()
+    void policy::priority::Remove(atomicx& thr)
     {
-        auto pAtomic = atomicx::GetCurrent();
+        uint8_t nPriority = thr.GetPriority ();
 
-        if(pAtomic == nullptr) return;
+        if (IsExpired (thr))
+        {
+            RemoveFifo (ms_paExpiredFirst[nPriority], ms_paExpiredLast[nPriority], thr);
 
-        if (bExclusiveLock == true)
+            if (ms_paExpiredFirst[nPriority] == nullptr)
+            {
+                ms_expiredMap &= ~(((uint32_t) 1) << nPriority);
+            }
+        }
+        else
         {
-            bExclusiveLock = false;
+            RemoveFifo (ms_paReadyFirst[nPriority], ms_paReadyLast[nPriority], thr);
 
-            // Notify Other locks procedures
-            pAtomic->Notify(nSharedLockCount, 2, NotifyType::all);
-            pAtomic->Notify(bExclusiveLock, 1, NotifyType::one);
+            if (ms_paReadyFirst[nPriority] == nullptr)
+            {
+                ms_readyMap &= ~(((uint32_t) 1) << nPriority);
+            }
         }
     }
 
-    bool atomicx::mutex::SharedLock(atomicx_time ttimeout)
+    atomicx* policy::priority::Select()
     {
-        Timeout timeout(ttimeout);
-        auto pAtomic = atomicx::GetCurrent();
-
-        if(pAtomic == nullptr) return false;
-
-        // Wait for exclusive mutex
-        while (bExclusiveLock > 0) if (! pAtomic->Wait(bExclusiveLock, 1, timeout.GetRemaining())) return false;
-
-        nSharedLockCount++;
+        if ((ms_readyMap | ms_expiredMap) == 0)
+        {
+            return nullptr;
+        }
 
-        // Notify Other locks procedures
-        pAtomic->Notify (nSharedLockCount, 2, NotifyType::one);
+        // Highest priority first, within a priority ready threads go before expired ones
+        uint8_t nPriority = HighestPriority (ms_readyMap | ms_expiredMap);
 
-        return true;
+        return ms_paReadyFirst[nPriority] != nullptr ? ms_paReadyFirst[nPriority] : ms_paExpiredFirst[nPriority];
     }
 
-    void atomicx::mutex::SharedUnlock()
+    void policy::priority::Sleep(atomicx& thr, atomicx_time& nSleep)
     {
-        auto pAtomic = atomicx::GetCurrent();
+        (void) thr;
+        (void) nSleep;
+    }
 
-        if(pAtomic == nullptr) return;
+#if ATOMICX_SCHED_FAIR
+    // Fair share
+    atomicx* policy::fairShare::ms_pFairShare=nullptr;
+    atomicx_time policy::fairShare::ms_nMinVirtualRuntime=0;
 
-        if (nSharedLockCount)
+    void policy::fairShare::Ready(atomicx& thr)
+    {
+        // A thread back from a sleep or wait does not get credit for the time it was away
+        if (VirtualRuntime (thr) < ms_nMinVirtualRuntime)
         {
-            nSharedLockCount--;
-
-            pAtomic->Notify(nSharedLockCount, 2, NotifyType::one);
+            VirtualRuntime (thr) = ms_nMinVirtualRuntime;
         }
+
+        PushHeap (ms_pFairShare, thr, VirtualRuntimeKey ());
     }
 
-    size_t atomicx::mutex::IsShared()
+    void policy::fairShare::Expired(atomicx& thr)
     {
-        return nSharedLockCount;
+        Ready (thr);
     }
 
-    bool atomicx::mutex::IsLocked()
+    void policy::fairShare::Remove(atomicx& thr)
     {
-        return bExclusiveLock;
+        RemoveHeap (ms_pFairShare, thr, VirtualRuntimeKey ());
     }
 
-    atomicx::smartMutex::smartMutex (mutex& lockObj) : m_lock(lockObj)
-    {}
-
-    atomicx::smartMutex::~smartMutex()
+    atomicx* policy::fairShare::Select()
     {
-        switch (m_lockType)
+        if (ms_pFairShare != nullptr && VirtualRuntime (*ms_pFairShare) > ms_nMinVirtualRuntime)
         {
-            case 'L':
-                m_lock.Unlock();
-                break;
-            case 'S':
-                m_lock.SharedUnlock();
-                break;
+            ms_nMinVirtualRuntime = VirtualRuntime (*ms_pFairShare);
         }
+
+        return ms_pFairShare;
     }
 
-    bool atomicx::smartMutex::SharedLock(atomicx_time ttimeout)
+    void policy::fairShare::Sleep(atomicx& thr, atomicx_time& nSleep)
     {
-        bool bRet = false;
+#if ATOMICX_TIMING_STATS
+        atomicx_time nExecTime = thr.GetLastUserExecTime ();
+#else
+        // No execution times, every turn is charged one tick
+        atomicx_time nExecTime = 0;
+#endif
 
-        if (m_lockType == '\0')
+        // Charge at least one tick so threads running for less than a tick still take turns
+        VirtualRuntime (thr) += ((nExecTime > 0 ? nExecTime : 1) * ATOMICX_FAIR_SHARE) / thr.GetShare ();
+
+        // Fair share does not use nice, a plain Yield() only hands the CPU over
+        if (nSleep == ATOMICX_TIME_MAX)
         {
-            if (m_lock.SharedLock(ttimeout))
-            {
-                m_lockType = 'S';
-                bRet = true;
-            }
+            nSleep = 0;
         }
-
-        return bRet;
     }
+#endif
 
-    bool atomicx::smartMutex::Lock(atomicx_time ttimeout)
-    {
-        bool bRet = false;
+    // Earliest deadline first
+    template <typename background> atomicx* policy::deadline<background>::ms_pDeadlines=nullptr;
 
-        if (m_lockType == '\0')
+    template <typename background> void policy::deadline<background>::Ready(atomicx& thr)
+    {
+        if (thr.GetPeriod () != 0)
         {
-            if (m_lock.Lock(ttimeout))
-            {
-                m_lockType = 'L';
-                bRet = true;
-            }
+            PushHeap (ms_pDeadlines, thr, DeadlineKey ());
+        }
+        else
+        {
+            background::Ready (thr);
         }
+    }
 
-        return bRet;
+    template <typename background> void policy::deadline<background>::Expired(atomicx& thr)
+    {
+        if (thr.GetPeriod () != 0)
+        {
+            PushHeap (ms_pDeadlines, thr, DeadlineKey ());
+        }
+        else
+        {
+            background::Expired (thr);
+        }
     }
 
-    size_t atomicx::smartMutex::IsShared()
+    template <typename background> void policy::deadline<background>::Remove(atomicx& thr)
     {
-        return m_lock.IsShared();
+        if (thr.GetPeriod () != 0)
+        {
+            RemoveHeap (ms_pDeadlines, thr, DeadlineKey ());
+        }
+        else
+        {
+            background::Remove (thr);
+        }
     }
 
-    bool atomicx::smartMutex::IsLocked()
+    template <typename background> atomicx* policy::deadline<background>::Select()
     {
-        return m_lock.IsLocked();
+        // Periodic thread with the earliest deadline, then the background policy
+        return ms_pDeadlines != nullptr ? ms_pDeadlines : background::Select ();
     }
 
-    uint16_t atomicx::crc16(const uint8_t* pData, size_t nSize, uint16_t nCRC)
+    template <typename background> void policy::deadline<background>::Sleep(atomicx& thr, atomicx_time& nSleep)
     {
-        #define POLY 0x8408
-        unsigned char nCount;
-        unsigned int data;
+        background::Sleep (thr, nSleep);
+    }
 
-        nCRC = ~nCRC;
+#if ATOMICX_STACK_COMPRESS
+    /*
+     * Stack codecs
+     */
 
-        if (nSize == 0) return (~nCRC);
+    // lz, control byte 0xxxxxxx: x + 1 literals follow, 1xxxxxxx: x + 4 bytes from the 16 bit LE offset back
+    static const uint8_t ms_nLzHashBits = 10;
+    static const size_t ms_nLzMinMatch = 4;
+    static const size_t ms_nLzMaxMatch = 0x7f + ms_nLzMinMatch;
+    static const size_t ms_nLzMaxLiterals = 0x80;
 
-        do
+    // Low 16 bits of the last position of each hash
+    static uint16_t ms_aLzTable[1 << ms_nLzHashBits];
+
+    static inline bool LzLiterals(const uint8_t* pIn, size_t nIn, uint8_t* pOut, size_t& nOut, size_t nOutMax)
+    {
+        while (nIn > 0)
         {
-            for (nCount = 0, data = (unsigned int)0xff & *pData++; nCount < 8; nCount++, data >>= 1)
+            size_t nRun = nIn > ms_nLzMaxLiterals ? ms_nLzMaxLiterals : nIn;
+
+            if (nOut + 1 + nRun > nOutMax)
             {
-                if ((nCRC & 0x0001) ^ (data & 0x0001))
-                    nCRC = (nCRC >> 1) ^ POLY;
-                else
-                    nCRC >>= 1;
+                return false;
             }
-        } while (--nSize);
 
-        nCRC = ~nCRC;
-        data = nCRC;
-        nCRC = (nCRC << 8) | (data >> 8 & 0xff);
+            pOut[nOut++] = (uint8_t) (nRun - 1);
 
-        return (nCRC);
-    }
+            memcpy (pOut + nOut, pIn, nRun);
 
-    atomicx_time atomicx::GetCurrentTick(void)
-    {
-        return Atomicx_GetTick ();
-    }
+            nOut += nRun;
+            pIn += nRun;
+            nIn -= nRun;
+        }
 
-    bool atomicx::IsStackSelfManaged(void)
-    {
-        return m_flags.autoStack;
+        return true;
     }
 
-    atomicx_time atomicx::GetLastUserExecTime()
+    size_t codec::lz::Compress(const uint8_t* pIn, size_t nIn, uint8_t* pOut, size_t nOutMax)
     {
-        return m_LastUserExecTime;
-    }
+        size_t nPos = 0;
+        size_t nLiterals = 0;
+        size_t nOut = 0;
 
-    void atomicx::SetStackIncreasePace(size_t nIncreasePace)
-    {
-        m_stackIncreasePace = nIncreasePace;
-    }
+        memset (ms_aLzTable, 0, sizeof (ms_aLzTable));
 
-    size_t atomicx::GetStackIncreasePace(void)
-    {
-        return m_stackIncreasePace;
-    }
+        while (nPos + ms_nLzMinMatch <= nIn)
+        {
+            uint32_t nWord;
 
-    void atomicx::SetDynamicNice(bool status)
-    {
-        m_flags.dynamicNice = status;
-    }
+            memcpy (&nWord, pIn + nPos, sizeof (nWord));
 
-    bool atomicx::IsDynamicNiceOn()
-    {
-        return m_flags.dynamicNice;
-    }
+            uint16_t& nLast = ms_aLzTable[(uint32_t) (nWord * 2654435761u) >> (32 - ms_nLzHashBits)];
+            size_t nBack = (uint16_t) (nPos - nLast);
 
-    atomicx* atomicx::GetThread(size_t threadId)
-    {
-        for (auto& th : *(thread::atomicx::GetCurrent()))
-        {
-            if (reinterpret_cast<size_t>(&th) == threadId)
+            nLast = (uint16_t) nPos;
+
+            if (nBack == 0 || nBack > nPos || memcmp (pIn + nPos - nBack, pIn + nPos, ms_nLzMinMatch) != 0)
             {
-                return &th;
+                nPos++;
+
+                continue;
             }
-        }
 
-        return nullptr;
-    }
+            size_t nLength = ms_nLzMinMatch;
 
-    atomicx& atomicx::GetThread (void)
-    {
-        return *this;
-    }
+            while (nPos + nLength < nIn && nLength < ms_nLzMaxMatch && pIn[nPos + nLength] == pIn[nPos + nLength - nBack])
+            {
+                nLength++;
+            }
 
-    size_t  atomicx::GetThreadCount()
-    {
-        size_t nCounter=0;
+            if (LzLiterals (pIn + nLiterals, nPos - nLiterals, pOut, nOut, nOutMax) == false || nOut + 3 > nOutMax)
+            {
+                return 0;
+            }
 
-        for (auto& th : *(thread::atomicx::GetCurrent()))
-        {
-            (void) th;
-            nCounter++;
+            pOut[nOut++] = (uint8_t) (0x80 | (nLength - ms_nLzMinMatch));
+            pOut[nOut++] = (uint8_t) nBack;
+            pOut[nOut++] = (uint8_t) (nBack >> 8);
+
+            nPos += nLength;
+            nLiterals = nPos;
         }
 
-        return nCounter;
-    }
+        if (LzLiterals (pIn + nLiterals, nIn - nLiterals, pOut, nOut, nOutMax) == false)
+        {
+            return 0;
+        }
 
-    void atomicx::SetReceiveBroadcast (bool bBroadcastStatus)
-    {
-        m_flags.broadcast = bBroadcastStatus;
+        return nOut;
     }
 
-    size_t atomicx::BroadcastMessage (const size_t messageReference, const Message message)
+    size_t codec::lz::Decompress(const uint8_t* pIn, size_t nIn, uint8_t* pOut, size_t nOut)
     {
-        size_t nReceived = 0;
+        size_t nPos = 0;
+        size_t nWritten = 0;
 
-        for (auto& thr : *this)
+        while (nPos < nIn)
         {
-            if (thr.m_flags.broadcast == true)
+            uint8_t nControl = pIn[nPos++];
+
+            if (nControl & 0x80)
             {
-                BroadcastHandler (messageReference, message);
-                nReceived++;
-            }
-        }
+                size_t nLength = (nControl & 0x7f) + ms_nLzMinMatch;
+                size_t nBack;
 
-        return nReceived;
-    }
+                if (nPos + 2 > nIn)
+                {
+                    return 0;
+                }
 
-    void atomicx::BroadcastHandler (const size_t& messageReference, const Message& message)
-    {
-        (void) messageReference; // to avoid unused variable
-        (void) message; // to avoid unused variable
-    }
+                nBack = pIn[nPos] | ((size_t) pIn[nPos + 1] << 8);
+                nPos += 2;
 
-    void atomicx::Stop ()
-    {
-        m_aStatus = aTypes::stop;
-        m_aSubStatus = aSubTypes::none;
-        m_nTargetTime = 0;
+                if (nBack == 0 || nBack > nWritten || nWritten + nLength > nOut)
+                {
+                    return 0;
+                }
 
-        Yield();
-    }
+                // Byte by byte, the match may overlap what it is writing
+                for (; nLength > 0; nLength--, nWritten++)
+                {
+                    pOut[nWritten] = pOut[nWritten - nBack];
+                }
+            }
+            else
+            {
+                size_t nRun = (size_t) nControl + 1;
 
-    void atomicx::Resume ()
-    {
-        m_aStatus = aTypes::now;
-        m_aSubStatus = aSubTypes::ok;
-        m_nTargetTime = 0;
+                if (nPos + nRun > nIn || nWritten + nRun > nOut)
+                {
+                    return 0;
+                }
 
-        Yield();        
-    }
+                memcpy (pOut + nWritten, pIn + nPos, nRun);
 
-    bool atomicx::IsStopped ()
-    {
-        return  m_aStatus == aTypes::stop;
-    }
+                nPos += nRun;
+                nWritten += nRun;
+            }
+        }
 
+        return nWritten;
+    }
+#endif
 }
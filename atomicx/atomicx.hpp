@@ -23,6 +23,279 @@ using atomicx_time = uint32_t;
 
 #define ATOMICX_TIME_MAX ((atomicx_time) ~0)
 
+/*
+ * Compile time options, to change any of them define it before
+ * including atomicx.hpp or on the compiler command line (-D)
+ */
+
+/**
+ * @brief Use a hierarchical timing wheel instead of the timer heap
+ *
+ * @note  Gives O(1) arm/cancel for Yield(nSleep) and timed Waits, ideal when most
+ *        timeouts are cancelled by a Notify before they expire. Costs
+ *        ATOMICX_WHEEL_LEVELS * 64 pointers of RAM.
+ */
+#ifndef ATOMICX_TIMER_WHEEL
+#define ATOMICX_TIMER_WHEEL 0
+#endif
+
+/**
+ * @brief Number of 64 slot levels of the timing wheel, each level covers 6 bits of tick,
+ *        timers beyond the last level are kept on an overflow list
+ */
+#ifndef ATOMICX_WHEEL_LEVELS
+#define ATOMICX_WHEEL_LEVELS 4
+#endif
+
+/**
+ * @brief Number of hash buckets (power of 2) used to index waiting threads by reference pointer
+ */
+#ifndef ATOMICX_WAIT_BUCKETS
+#define ATOMICX_WAIT_BUCKETS 16
+#endif
+
+/**
+ * @brief Number of thread priority levels (1 to 32), 0 is the lowest and default priority
+ */
+#ifndef ATOMICX_PRIORITIES
+#define ATOMICX_PRIORITIES 8
+#endif
+
+/**
+ * @brief Set to 1 to run periodic threads Earliest Deadline First, ahead of the non periodic ones
+ */
+#ifndef ATOMICX_SCHED_EDF
+#define ATOMICX_SCHED_EDF 0
+#endif
+
+/**
+ * @brief Set to 1 to pick runnable threads by least virtual runtime (fair share) instead of by priority,
+ *        0 compiles the virtual runtime, the share and the fairShare policy out
+ */
+#ifndef ATOMICX_SCHED_FAIR
+#define ATOMICX_SCHED_FAIR 0
+#endif
+
+/**
+ * @brief Default fair share of a thread, virtual runtime grows by exec time * ATOMICX_FAIR_SHARE / share
+ */
+#ifndef ATOMICX_FAIR_SHARE
+#define ATOMICX_FAIR_SHARE 1024
+#endif
+
+/**
+ * @brief Set to 1 (x86-64 and AArch64 only) to run every thread on its own stack, switching
+ *        by swapping the stack pointer instead of copying the used stack out and back
+ *
+ * @note  Fixed stack buffers must hold the deepest call chain, libc included. A buffer smaller
+ *        than ATOMICX_DEDICATED_STACK_SIZE is replaced by a heap stack of that size when the
+ *        thread first runs, without ATOMICX_AUTO_STACK it does not compile. Auto stacks are
+ *        allocated with at least ATOMICX_DEDICATED_STACK_SIZE bytes
+ */
+#ifndef ATOMICX_DEDICATED_STACK
+#define ATOMICX_DEDICATED_STACK 0
+#endif
+
+/**
+ * @brief Minimum size of any stack (fixed or auto) with ATOMICX_DEDICATED_STACK
+ */
+#ifndef ATOMICX_DEDICATED_STACK_SIZE
+#define ATOMICX_DEDICATED_STACK_SIZE 16384
+#endif
+
+/**
+ * @brief Set to 1 to keep the saved stack of idle auto stack threads in a size classed arena,
+ *        allocated to the live bytes on every switch and released while the thread runs
+ *
+ * @note  Only for the copy backend, all threads already share the kernel stack for execution,
+ *        this makes an idle thread cost its live stack (rounded to the size class) plus the
+ *        control block, instead of a private buffer sized to its high water mark
+ */
+#ifndef ATOMICX_STACK_ARENA
+#define ATOMICX_STACK_ARENA 0
+#endif
+
+/**
+ * @brief Bytes the stack arena reserves from the heap at a time to carve the size classes
+ */
+#ifndef ATOMICX_STACK_ARENA_CHUNK
+#define ATOMICX_STACK_ARENA_CHUNK 4096
+#endif
+
+/**
+ * @brief Largest stack arena size class (power of 2, at least 256), bigger saved stacks go
+ *        straight to malloc/free
+ */
+#ifndef ATOMICX_STACK_ARENA_MAX
+#define ATOMICX_STACK_ARENA_MAX 16384
+#endif
+
+/**
+ * @brief Set to 1 to serve the auto stack buffers from the stack arena size classes, growing them
+ *        geometrically and shrinking them back after a run of low usage switches (copy backend only)
+ */
+#ifndef ATOMICX_STACK_POOL
+#define ATOMICX_STACK_POOL 0
+#endif
+
+/**
+ * @brief Most bytes a pooled auto stack grows beyond the used stack plus pace, bounding the doubling
+ */
+#ifndef ATOMICX_STACK_GROW_MAX
+#define ATOMICX_STACK_GROW_MAX 1024
+#endif
+
+/**
+ * @brief Consecutive switches using at most a quarter of a pooled auto stack before it is shrunk back
+ */
+#ifndef ATOMICX_STACK_SHRINK_SWITCHES
+#define ATOMICX_STACK_SHRINK_SWITCHES 64
+#endif
+
+/**
+ * @brief Set to 1 to save and restore stacks incrementally, chunk by chunk (from the stack base),
+ *        only writing the chunks that differ from the other side (copy backend, not with the arena)
+ *
+ * @note  Pays a compare for every chunk, wins on deep but stable call chains
+ */
+#ifndef ATOMICX_STACK_INCREMENTAL
+#define ATOMICX_STACK_INCREMENTAL 0
+#endif
+
+/**
+ * @brief Chunk size in bytes for ATOMICX_STACK_INCREMENTAL
+ */
+#ifndef ATOMICX_STACK_CHUNK
+#define ATOMICX_STACK_CHUNK 64
+#endif
+
+/**
+ * @brief Set to 1 (x86-64, GCC or Clang) to copy stacks with the fastest of the ERMS (rep movsb),
+ *        AVX2 and SSE2 kernels the CPU supports, chosen by CPUID when Start() is called
+ */
+#ifndef ATOMICX_STACK_COPY_KERNELS
+#define ATOMICX_STACK_COPY_KERNELS 0
+#endif
+
+/**
+ * @brief Set to 1 to compress the saved stack of auto stack threads parked (not running) for
+ *        ATOMICX_STACK_COMPRESS_AFTER ticks, it is decompressed when the thread is selected
+ *        to run again (copy backend only)
+ */
+#ifndef ATOMICX_STACK_COMPRESS
+#define ATOMICX_STACK_COMPRESS 0
+#endif
+
+/**
+ * @brief Ticks a thread must be parked before its saved stack is compressed
+ */
+#ifndef ATOMICX_STACK_COMPRESS_AFTER
+#define ATOMICX_STACK_COMPRESS_AFTER 1000
+#endif
+
+/**
+ * @brief Codec used by ATOMICX_STACK_COMPRESS (see thread::codec). A custom codec can be given
+ *        together with ATOMICX_STACK_CODEC_HEADER, the header that defines it, which is included
+ *        by atomicx.cpp
+ */
+#ifndef ATOMICX_STACK_CODEC
+#define ATOMICX_STACK_CODEC thread::codec::lz
+#endif
+
+/**
+ * @brief Set to 1 to profile the stack use of every thread (high water mark, the Yield call site
+ *        that reached it and a histogram) and get recommended fixed stack sizes from
+ *        atomicx::StackProfileReport
+ */
+#ifndef ATOMICX_STACK_PROFILE
+#define ATOMICX_STACK_PROFILE 0
+#endif
+
+/**
+ * @brief Safety margin, in percent of the high water mark, added to the recommended stack sizes
+ */
+#ifndef ATOMICX_STACK_PROFILE_MARGIN
+#define ATOMICX_STACK_PROFILE_MARGIN 25
+#endif
+
+/**
+ * @brief Set to 1 for a kernel that never touches the heap: auto stacks (the atomicx(nStackSize,
+ *        nStackIncreasePace) constructor), smart_ptr and queue<T> without a compile time size are
+ *        rejected at compile time, use fixed stacks and queue<T, N>
+ */
+#ifndef ATOMICX_NO_HEAP
+#define ATOMICX_NO_HEAP 0
+#endif
+
+/**
+ * @brief Set to 0 to compile out auto stacks (the atomicx(nStackSize, nStackIncreasePace) constructor
+ *        and the stack resize in Yield), off by default with ATOMICX_NO_HEAP
+ */
+#ifndef ATOMICX_AUTO_STACK
+#if ATOMICX_NO_HEAP
+#define ATOMICX_AUTO_STACK 0
+#else
+#define ATOMICX_AUTO_STACK 1
+#endif
+#endif
+
+/**
+ * @brief Set to 0 to compile out the user execution time of each thread (GetLastUserExecTime),
+ *        saves two tick reads per context switch
+ */
+#ifndef ATOMICX_TIMING_STATS
+#define ATOMICX_TIMING_STATS 1
+#endif
+
+/**
+ * @brief Set to 0 to compile out dynamic nice (SetDynamicNice), needs ATOMICX_TIMING_STATS
+ */
+#ifndef ATOMICX_DYNAMIC_NICE
+#define ATOMICX_DYNAMIC_NICE ATOMICX_TIMING_STATS
+#endif
+
+/**
+ * @brief Set to 0 to compile out message broadcast (BroadcastMessage, BroadcastHandler)
+ */
+#ifndef ATOMICX_BROADCAST
+#define ATOMICX_BROADCAST 1
+#endif
+
+/**
+ * @brief Slots of the thread registry (GetHandle). With a heap the table doubles when full (up
+ *        to 65534 slots); with ATOMICX_NO_HEAP it is the hard cap and threads created while it is
+ *        full run normally but get an invalid handle, counted by GetHandleMisses()
+ */
+#ifndef ATOMICX_THREAD_SLOTS
+#define ATOMICX_THREAD_SLOTS 16
+#endif
+
+/**
+ * @brief Bytes of payload a thread can receive with WaitPayload (up to a cache line is the
+ *        intended use), kept in every thread control block, 0 compiles the payload calls out
+ */
+#ifndef ATOMICX_PAYLOAD_SIZE
+#define ATOMICX_PAYLOAD_SIZE 0
+#endif
+
+/**
+ * @brief Scheduler policy (see thread::policy), by default derived from ATOMICX_SCHED_EDF and
+ *        ATOMICX_SCHED_FAIR, fairShare is only compiled in with ATOMICX_SCHED_FAIR. A custom policy
+ *        can be given together with ATOMICX_SCHED_POLICY_HEADER, the header that defines it, which
+ *        is included by atomicx.cpp
+ */
+#ifndef ATOMICX_SCHED_POLICY
+#if ATOMICX_SCHED_EDF && ATOMICX_SCHED_FAIR
+#define ATOMICX_SCHED_POLICY thread::policy::deadline<thread::policy::fairShare>
+#elif ATOMICX_SCHED_EDF
+#define ATOMICX_SCHED_POLICY thread::policy::deadline<thread::policy::priority>
+#elif ATOMICX_SCHED_FAIR
+#define ATOMICX_SCHED_POLICY thread::policy::fairShare
+#else
+#define ATOMICX_SCHED_POLICY thread::policy::priority
+#endif
+#endif
+
 /**
  * @brief Calculate the stack size based on MCU channel size 8, 16, 32, 64 bits multiples
  * 
@@ -240,6 +513,13 @@ namespace thread
         LinkItem<T>* last=nullptr;
     };
 
+    class atomicx;
+
+    namespace policy
+    {
+        struct base;
+    }
+
     class atomicx
     {
     public:
@@ -269,7 +549,8 @@ namespace thread
             ok,
             look,
             wait,
-            timeout
+            timeout,
+            transfer
         };
 
         enum class NotifyType : uint8_t
@@ -278,12 +559,63 @@ namespace thread
             all = 1
         };
 
+#if ATOMICX_STACK_COPY_KERNELS
+        enum class StackCopy : uint8_t
+        {
+            portable = 0,
+            sse2,
+            erms,
+            avx2
+        };
+#endif
+
         struct Message
         {
             size_t message;
             size_t tag;
         };
 
+        /**
+         * @brief A mutex or binary semaphore in the list of locks its holder owns, so the holder
+         *        priority is recomputed from the waiters of these locks only
+         */
+        struct heldLock
+        {
+            const void* pLockId;    // The wait queue key of the lock waiters
+            heldLock* pNext;
+        };
+
+        /**
+         * @brief Thread handle: a thread registry slot and the generation of the slot when the
+         *        thread took it, the handle of a gone thread never matches the next one in that slot.
+         *        A zero initialized handle is never valid.
+         */
+        struct Handle
+        {
+            uint16_t index;
+            uint16_t generation;
+        };
+
+        /**
+         * @brief One piece of a SendV message, the segments are gathered in order
+         */
+        struct Segment
+        {
+            const uint8_t* pData;
+            size_t nSize;
+        };
+
+        /**
+         * @brief SendV result for one receiver: the thread and the bytes copied into its buffer,
+         *        less than the message size if its buffer was smaller, {nullptr, 0} if no
+         *        receiver took that place before the timeout
+         */
+        struct Delivery
+        {
+            atomicx* pReceiver;
+            size_t nSize;
+        };
+
         /**
          * @brief Timeout Check object
          */
@@ -363,6 +695,7 @@ namespace thread
          */
         iterator<atomicx> end(void);
 
+#if ATOMICX_NO_HEAP == 0
         /**
          * ------------------------------
          * SUPLEMENTAR SMART_PTR IMPLEMENTATION
@@ -490,6 +823,7 @@ namespace thread
 
             reference* pRef=nullptr;
         };
+#endif
 
         /**
          * ------------------------------
@@ -497,124 +831,134 @@ namespace thread
          * ------------------------------
          */
 
+        /**
+         * @brief Ring buffer operations shared by the queue storages
+         *
+         * @tparam T    Item type, must be default constructible and movable
+         */
         template<typename T>
-        class queue
+        class queueRing
         {
         public:
 
-            queue() = delete;
+            static void Put(T* pRing, size_t nSize, size_t& nHead, bool bFront, size_t nItems, T&& item)
+            {
+                Slot (pRing, nSize, nHead, bFront, nItems) = static_cast<T&&>(item);
+            }
 
-            /**
-             * @brief Thread Safe Queue constructor
-             *
-             * @param nQSize Max number of objects to hold
-             */
-            queue(size_t nQSize):m_nQSize(nQSize), m_nItens{0}
-            {}
+            template<typename... Args> static void Put(T* pRing, size_t nSize, size_t& nHead, bool bFront, size_t nItems, Args&&... args)
+            {
+                Slot (pRing, nSize, nHead, bFront, nItems) = T(static_cast<Args&&>(args)...);
+            }
 
-            /**
-             * @brief Push an object to the end of the queue, if the queue
-             *        is full, it waits till there is a space.
-             *
-             * @param item  The object to be pushed into the queue
-             *
-             * @return true if it was able to push a object in the queue, false otherwise
-             */
-            bool PushBack(T item)
+            static T Take(T* pRing, size_t nSize, size_t& nHead)
             {
-                if (m_nItens >= m_nQSize)
+                T item = static_cast<T&&>(pRing[nHead]);
+
+                if (++nHead == nSize)
                 {
-                    if (atomicx::GetCurrent() != nullptr)
-                    {
-                        atomicx::GetCurrent()->Wait(*this,1);
-                    }
-                    else
-                    {
-                        return false;
-                    }
+                    nHead = 0;
                 }
 
-                QItem* pQItem = new QItem(item);
+                return item;
+            }
 
-                if (m_pQIStart == nullptr)
-                {
-                    m_pQIStart = m_pQIEnd = pQItem;
-                }
-                else
+        private:
+
+            static T& Slot(T* pRing, size_t nSize, size_t& nHead, bool bFront, size_t nItems)
+            {
+                if (bFront)
                 {
-                    m_pQIEnd->SetNext(*pQItem);
-                    m_pQIEnd = pQItem;
+                    nHead = (nHead == 0 ? nSize : nHead) - 1;
+
+                    return pRing[nHead];
                 }
 
-                m_nItens++;
+                size_t nTail = nHead + nItems;
 
-                if (atomicx::GetCurrent() != nullptr)
-                {
-                    atomicx::GetCurrent()->Notify(*this,0);
-                }
+                return pRing[nTail >= nSize ? nTail - nSize : nTail];
+            }
+        };
 
-                return true;
+        /**
+         * @brief Queue storage, a ring of N items inside the queue object, no heap
+         *
+         * @tparam T    Item type, must be default constructible and movable
+         * @tparam N    Max number of items
+         */
+        template<typename T, size_t N>
+        class queueStore
+        {
+        protected:
+
+            template<typename... Args> void Put(bool bFront, size_t nItems, Args&&... args)
+            {
+                queueRing<T>::Put (m_aRing, N, m_nHead, bFront, nItems, static_cast<Args&&>(args)...);
             }
 
+            T Take()
+            {
+                return queueRing<T>::Take (m_aRing, N, m_nHead);
+            }
 
-            /**
-             * @brief Push an object to the beggining of the queue, if the queue
-             *        is full, it waits till there is a space.
-             *
-             * @param item  The object to be pushed into the queue
-             *
-             * @return true if it was able to push a object in the queue, false otherwise
-             */
-            bool PushFront(T item)
+        private:
+            T m_aRing[N];
+            size_t m_nHead = 0;
+        };
+
+        /**
+         * @brief Queue storage for queue<T> without N: a ring in a caller supplied buffer, or
+         *        a linked list of heap allocated items when no buffer is given
+         */
+        template<typename T>
+        class queueStore<T, 0>
+        {
+        protected:
+
+            void SetRing(T* pBuffer, size_t nSize)
             {
-                if (m_nItens >= m_nQSize)
+                m_pRing = pBuffer;
+                m_nRingSize = nSize;
+            }
+
+            template<typename... Args> void Put(bool bFront, size_t nItems, Args&&... args)
+            {
+                if (m_pRing != nullptr)
                 {
-                    if (atomicx::GetCurrent() != nullptr)
-                    {
-                        atomicx::GetCurrent()->Wait(*this,1);
-                    }
-                    else
-                    {
-                        return false;
-                    }
+                    queueRing<T>::Put (m_pRing, m_nRingSize, m_nHead, bFront, nItems, static_cast<Args&&>(args)...);
+
+                    return;
                 }
 
-                QItem* pQItem = new QItem(item);
+#if ATOMICX_NO_HEAP == 0
+                QItem* pQItem = new QItem(static_cast<Args&&>(args)...);
 
                 if (m_pQIStart == nullptr)
                 {
                     m_pQIStart = m_pQIEnd = pQItem;
                 }
-                else
+                else if (bFront)
                 {
                     pQItem->SetNext(*m_pQIStart);
                     m_pQIStart = pQItem;
                 }
-
-                m_nItens++;
-
-                if (atomicx::GetCurrent() != nullptr)
+                else
                 {
-                    atomicx::GetCurrent()->Notify    (*this,0);
+                    m_pQIEnd->SetNext(*pQItem);
+                    m_pQIEnd = pQItem;
                 }
-
-                return true;
+#endif
             }
 
-            /**
-             * @brief Pop an Item from the beggining of queue. Is no object there is no
-             *        object in the queue, it waits for it.
-             *
-             * @return T return the object stored.
-             */
-            T Pop()
+            T Take()
             {
-                if (m_nItens == 0)
+                if (m_pRing != nullptr)
                 {
-                    atomicx::GetCurrent()->Wait(*this,0);
+                    return queueRing<T>::Take (m_pRing, m_nRingSize, m_nHead);
                 }
 
-                T pItem = m_pQIStart->GetItem();
+#if ATOMICX_NO_HEAP == 0
+                T pItem = static_cast<T&&>(m_pQIStart->GetItem());
 
                 QItem* p_tmpQItem = m_pQIStart;
 
@@ -622,63 +966,25 @@ namespace thread
 
                 delete p_tmpQItem;
 
-                m_nItens--;
-
-                if (atomicx::GetCurrent() != nullptr)
-                {
-                    atomicx::GetCurrent()->Notify(*this,1);
-                }
-
                 return pItem;
+#else
+                return T();
+#endif
             }
 
             /**
-             * @brief Get the number of the objects in the queue
-             *
-             * @return size_t Number of the objects in the queue
-             */
-            size_t GetSize()
-            {
-                return m_nItens;
-            }
-
-            /**
-             * @brief Get the Max number of object in the queue can hold
-             *
-             * @return size_t   The max number of object
+             * @brief Queue Item object
              */
-            size_t GetMaxSize()
+            class QItem
             {
-                return m_nQSize;
-            }
-
-            /**
-             * @brief Check if the queue is full
-             *
-             * @return true for yes, otherwise false
-             */
-            bool IsFull()
-            {
-                return m_nItens >= m_nQSize;
-            }
-
-        protected:
-
-            /**
-             * @brief Queue Item object
-             */
-            class QItem
-            {
-            public:
-                QItem () = delete;
-
-                /**
-                 * @brief Queue Item constructor
-                 *
-                 * @param qItem Obj template type T
-                 */
-                QItem(T& qItem) : m_qItem(qItem), m_pNext(nullptr)
-                {}
+            public:
+                /**
+                 * @brief Queue Item constructor, the item is constructed in place
+                 *
+                 * @param args  T constructor arguments
+                 */
+                template<typename... Args> QItem(Args&&... args) : m_qItem(static_cast<Args&&>(args)...), m_pNext(nullptr)
+                {}
 
                 /**
                  * @brief Get the current object in the QItem
@@ -691,7 +997,7 @@ namespace thread
                 }
 
             protected:
-                friend class queue;
+                friend class queueStore;
 
                 /**
                  * @brief Set Next Item in the Queue list
@@ -720,757 +1026,2117 @@ namespace thread
             };
 
         private:
-            size_t m_nQSize;
-            size_t m_nItens;
-
+            T* m_pRing = nullptr;
+            size_t m_nRingSize = 0;
+            size_t m_nHead = 0;
             QItem* m_pQIEnd = nullptr;
             QItem* m_pQIStart = nullptr;
-
         };
 
         /**
-         * --------------------------------
-         * SEMAPHORES IMPLEMENTATION
-         * --------------------------------
+         * @brief Thread safe queue
+         *
+         * @tparam T    Item type
+         * @tparam N    0 (default) items are kept in a caller supplied buffer, or allocated on push
+         *              and freed on pop if none is given, otherwise the queue holds up to N items
+         *              in a ring inside the object, no heap
          */
-
-        class semaphore
-        {
-            public:
-                /**
-                 * @brief Construct a new semaphore with MaxShared allowed
-                 *
-                 * @param nMaxShred     Max shared lock
-                 */
-                semaphore(size_t nMaxShared);
-
-                /**
-                 * @brief Acquire a shared lock context, if already on max shared allowed, wait till one is release or timeout
-                 *
-                 * @param nTimeout  default = 0 (indefinitely), How long to wait of accquiring
-                 *
-                 * @return true if it acquired the context, otherwise timeout returns false
-                 */
-                bool acquire(atomicx_time nTimeout = 0);
-
-                /**
-                 * @brief Releases one shared lock
-                 */
-                void release();
-
-                /**
-                 * @brief Get How many shared locks at a given moment
-                 *
-                 * @return size_t   Number of shared locks
-                 */
-                size_t GetCount();
-
-                /**
-                 * @brief Get how many waiting threads for accquiring context
-                 *
-                 * @return size_t   Number of waiting threads
-                 */
-                size_t GetWaitCount();
-
-                /**
-                 * @brief Get the Max Acquired Number
-                 *
-                 * @return size_t   The max acquired context number
-                 */
-                size_t GetMaxAcquired();
-
-                /**
-                 * @brief Get the maximun accquired context possible
-                 *
-                 * @return size_t
-                 */
-                static size_t GetMax ();
-
-            private:
-                size_t m_counter=0;
-                size_t m_maxShared;
-        };
-
-        class smartSemaphore
+        template<typename T, size_t N = 0>
+        class queue : private queueStore<T, N>
         {
-            public:
-                /**
-                 * @brief Acquire and managed the semaphore
-                 *
-                 * @param sem   base semaphore
-                 */
-                smartSemaphore (atomicx::semaphore& sem);
-                smartSemaphore () = delete;
-                /**
-                 * @brief Destroy the smart Semaphore while releasing it
-                 */
-                ~smartSemaphore();
-
-                /**
-                 * @brief Acquire a shared lock context, if already on max shared allowed, wait till one is release or timeout
-                 *
-                 * @param nTimeout  default = 0 (indefinitely), How long to wait of accquiring
-                 *
-                 * @return true if it acquired the context, otherwise timeout returns false
-                 */
-                bool acquire(atomicx_time nTimeout = 0);
-
-                /**
-                 * @brief Releases one shared lock
-                 */
-                void release();
-
-                /**
-                 * @brief Get How many shared locks at a given moment
-                 *
-                 * @return size_t   Number of shared locks
-                 */
-                size_t GetCount();
-
-                /**
-                 * @brief Get how many waiting threads for accquiring context
-                 *
-                 * @return size_t   Number of waiting threads
-                 */
-                size_t GetWaitCount();
+        public:
 
-                /**
-                 * @brief Get the Max Acquired Number
-                 *
-                 * @return size_t   The max acquired context number
-                 */
-                size_t GetMaxAcquired();
+            /**
+             * @brief Thread Safe Queue constructor, queue<T, N> only, holds up to N objects
+             */
+            queue() : m_nQSize(N), m_nItens{0}
+            {
+                static_assert (N > 0 || sizeof (T) == 0, "queue<T> needs a size, use queue<T>(nQSize) or queue<T, N>");
+            }
 
-                /**
-                 * @brief Get the maximun accquired context possible
-                 *
-                 * @return size_t
-                 */
-                static size_t GetMax ();
+            /**
+             * @brief Thread Safe Queue constructor
+             *
+             * @param nQSize Max number of objects to hold, queue<T, N> holds N at most
+             */
+            queue(size_t nQSize):m_nQSize(N > 0 && nQSize > N ? N : nQSize), m_nItens{0}
+            {
+                static_assert (ATOMICX_NO_HEAP == 0 || N > 0 || sizeof (T) == 0, "ATOMICX_NO_HEAP: queue<T> allocates its items, use queue<T, N> or queue<T>(buffer)");
+            }
 
-                /**
-                 * @brief  Report if the smartSemaphore has acquired a shared context
-                 *
-                 * @return true if it has successfully acquired a shared context otherwise false
-                 */
-                bool IsAcquired ();
+            /**
+             * @brief Thread Safe Queue constructor, queue<T> only, items are kept in pBuffer, no heap
+             *
+             * @param pBuffer   Ring buffer, it must outlive the queue
+             * @param nQSize    Number of items pBuffer holds
+             */
+            queue(T* pBuffer, size_t nQSize):m_nQSize(nQSize), m_nItens{0}
+            {
+                static_assert (N == 0 || sizeof (T) == 0, "queue<T, N> has its own buffer");
 
-            private:
-            semaphore& m_sem;
-            bool bAcquired = false;
-        };
+                this->SetRing (pBuffer, nQSize);
+            }
 
-        /**
-         * ------------------------------
-         * SMART LOCK IMPLEMENTATION
-         * ------------------------------
-         */
+            /**
+             * @brief Thread Safe Queue constructor, queue<T> only, items are kept in aBuffer, no heap
+             *
+             * @param aBuffer   Ring buffer, it must outlive the queue
+             */
+            template<size_t nSize> queue(T (&aBuffer)[nSize]) : queue(aBuffer, nSize)
+            {}
 
-        /* The stamart mutex implementation */
-        class mutex
-        {
-        public:
             /**
-             * @brief Exclusive/binary lock the smart lock
+             * @brief Push an object to the end of the queue, if the queue
+             *        is full, it waits till there is a space.
              *
-             * @note Once Lock() methos is called, if any thread held a shared lock,
-             *       the Lock will wait for it to finish in order to acquire the exclusive
-             *       lock, and all other threads that needs to a shared lock will wait till
-             *       Lock is accquired and released.
+             * @param item  The object to be pushed into the queue, moved into it
+             *
+             * @return true if it was able to push a object in the queue, false otherwise
              */
-            bool Lock(atomicx_time ttimeout=0);
+            bool PushBack(T item)
+            {
+                return Insert (false, true, static_cast<T&&>(item));
+            }
+
 
             /**
-             * @brief Release the exclusive lock
+             * @brief Push an object to the beggining of the queue, if the queue
+             *        is full, it waits till there is a space.
+             *
+             * @param item  The object to be pushed into the queue, moved into it
+             *
+             * @return true if it was able to push a object in the queue, false otherwise
              */
-            void Unlock();
+            bool PushFront(T item)
+            {
+                return Insert (true, true, static_cast<T&&>(item));
+            }
 
             /**
-             * @brief Shared Lock for the smart Lock
+             * @brief Construct an object at the end of the queue, if the queue
+             *        is full, it waits till there is a space.
              *
-             * @note Shared lock can only be accquired if no Exclusive lock is waiting or already accquired a exclusive lock,
-             *       In contrast, if at least one thread holds a shared lock, any exclusive lock can only be accquired once it
-             *       is released.
+             * @param args  T constructor arguments
+             *
+             * @return true if it was able to push a object in the queue, false otherwise
+             *
+             * @note queue<T> without buffer constructs the item in place, the ring
+             *       storages move assign a temporary to the slot
              */
-            bool SharedLock(atomicx_time ttimeout=0);
+            template<typename... Args> bool Emplace(Args&&... args)
+            {
+                return Insert (false, true, static_cast<Args&&>(args)...);
+            }
 
             /**
-             * @brief Release the current shared lock
+             * @brief Push an object to the end of the queue if there is space, never waits
+             *
+             * @param item  The object to be pushed into the queue, moved into it
+             *
+             * @return true if it was pushed, false if the queue is full
              */
-            void SharedUnlock();
+            bool TryPushBack(T item)
+            {
+                return Insert (false, false, static_cast<T&&>(item));
+            }
 
             /**
-             * @brief Check how many shared locks are accquired
+             * @brief Push an object to the beggining of the queue if there is space, never waits
              *
-             * @return size_t   Number of threads holding shared locks
+             * @param item  The object to be pushed into the queue, moved into it
+             *
+             * @return true if it was pushed, false if the queue is full
              */
-            size_t IsShared();
+            bool TryPushFront(T item)
+            {
+                return Insert (true, false, static_cast<T&&>(item));
+            }
 
             /**
-             * @brief Check if a exclusive lock has been already accquired
+             * @brief Move many objects to the end of the queue, waiting for space as needed,
+             *        waiting poppers are notified once per filled chunk instead of per object
              *
-             * @return true if yes, otherwise false
+             * @param pItems    Objects to push, left moved from
+             * @param nCount    Number of objects
+             *
+             * @return size_t   Number of objects pushed, less than nCount only if it could not wait
              */
-            bool IsLocked();
+            size_t PushBatch(T* pItems, size_t nCount)
+            {
+                size_t nPushed = 0;
 
-        protected:
-        private:
-            size_t nSharedLockCount=0;
-            bool bExclusiveLock=false;
-        };
+                while (nPushed < nCount && WaitFor (1, 0))
+                {
+                    size_t nChunk = m_nQSize - m_nItens;
 
-        /**
-         * @brief RII compliance lock/shared lock to auto unlock on destruction
-         *
-         */
-        class smartMutex
-        {
-            public:
-                smartMutex() = delete;
+                    if (nChunk > nCount - nPushed)
+                    {
+                        nChunk = nCount - nPushed;
+                    }
 
-                /**
-                 * @brief Construct a new Smart Lock object based a existing lock
-                 *
-                 * @param lockObj the existing lock object
-                 */
-                smartMutex (mutex& lockObj);
+                    for (size_t nItem = 0; nItem < nChunk; nItem++)
+                    {
+                        this->Put (false, m_nItens + nItem, static_cast<T&&>(pItems[nPushed + nItem]));
+                    }
 
-                /**
-                 * @brief Destroy and release the smart lock taken
-                 */
-                ~smartMutex();
+                    m_nItens += nChunk;
+                    nPushed += nChunk;
 
+                    Wake (2, nChunk);
+                }
+
+                return nPushed;
+            }
+
+            /**
+             * @brief Pop an Item from the beggining of queue. Is no object there is no
+             *        object in the queue, it waits for it.
+             *
+             * @return T return the object stored, T() if the wait failed (kernel stopped or not
+             *         called from a thread), the queue is left untouched then
+             *
+             * @note Must be called from a thread, there is nothing to return otherwise
+             */
+            T Pop()
+            {
+                if (! WaitFor (2, 0))
+                {
+                    return T();
+                }
+
+                return TakeItem ();
+            }
+
+            /**
+             * @brief Pop an Item from the beggining of queue, waiting at most nTimeout for it
+             *
+             * @param item      Receives the object
+             * @param nTimeout  Max ticks to wait, 0 waits indefinitely
+             *
+             * @return true if an object was popped, false on timeout
+             */
+            bool Pop(T& item, atomicx_time nTimeout)
+            {
+                if (! WaitFor (2, nTimeout))
+                {
+                    return false;
+                }
+
+                item = TakeItem ();
+
+                return true;
+            }
+
+            /**
+             * @brief Pop an Item from the beggining of queue if there is one, never waits
+             *
+             * @param item  Receives the object
+             *
+             * @return true if an object was popped, false if the queue is empty
+             */
+            bool TryPop(T& item)
+            {
+                if (m_nItens == 0)
+                {
+                    return false;
+                }
+
+                item = TakeItem ();
+
+                return true;
+            }
+
+            /**
+             * @brief Drain up to nMax objects, waiting at most nTimeout for the first one,
+             *        waiting pushers are notified once for the whole batch
+             *
+             * @param pItems    Receives the objects
+             * @param nMax      Max number of objects to pop
+             * @param nTimeout  Max ticks to wait for the first object, 0 waits indefinitely
+             *
+             * @return size_t   Number of objects popped, 0 on timeout
+             */
+            size_t PopBatch(T* pItems, size_t nMax, atomicx_time nTimeout = 0)
+            {
+                if (nMax == 0 || ! WaitFor (2, nTimeout))
+                {
+                    return 0;
+                }
+
+                size_t nCount = m_nItens < nMax ? m_nItens : nMax;
+
+                for (size_t nItem = 0; nItem < nCount; nItem++)
+                {
+                    pItems[nItem] = this->Take ();
+                }
+
+                m_nItens -= nCount;
+
+                Wake (1, nCount);
+
+                return nCount;
+            }
+
+            /**
+             * @brief Get the number of the objects in the queue
+             *
+             * @return size_t Number of the objects in the queue
+             */
+            size_t GetSize()
+            {
+                return m_nItens;
+            }
+
+            /**
+             * @brief Get the Max number of object in the queue can hold
+             *
+             * @return size_t   The max number of object
+             */
+            size_t GetMaxSize()
+            {
+                return m_nQSize;
+            }
+
+            /**
+             * @brief Check if the queue is full
+             *
+             * @return true for yes, otherwise false
+             */
+            bool IsFull()
+            {
+                return m_nItens >= m_nQSize;
+            }
+
+        private:
+
+            template<typename... Args> bool Insert(bool bFront, bool bWait, Args&&... args)
+            {
+                if (bWait ? ! WaitFor (1, 0) : IsFull ())
+                {
+                    return false;
+                }
+
+                this->Put (bFront, m_nItens, static_cast<Args&&>(args)...);
+
+                m_nItens++;
+
+                Wake (2, 1);
+
+                return true;
+            }
+
+            T TakeItem()
+            {
+                T item = this->Take ();
+
+                m_nItens--;
+
+                Wake (1, 1);
+
+                return item;
+            }
+
+            /**
+             * @brief Wait for space (nTag 1) or items (nTag 2), tag 0 is not a valid Wait tag
+             *
+             * @return true if there is space or items, false on timeout or outside a thread
+             */
+            bool WaitFor(size_t nTag, atomicx_time nTimeout)
+            {
+                Timeout timeout(nTimeout);
+                uint16_t& nWaiting = nTag == 1 ? m_nPushWaiting : m_nPopWaiting;
+
+                while (nTag == 1 ? m_nItens >= m_nQSize : m_nItens == 0)
+                {
+                    atomicx_time nRemaining = nTimeout > 0 ? timeout.GetRemaining () : 0;
+
+                    if ((nTimeout > 0 && nRemaining == 0) || atomicx::GetCurrent() == nullptr)
+                    {
+                        return false;
+                    }
+
+                    nWaiting++;
+                    bool bNotified = atomicx::GetCurrent()->Wait(*this, nTag, nRemaining);
+                    nWaiting--;
+
+                    if (! bNotified)
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            /**
+             * @brief Notify the pushers (nTag 1) or poppers (nTag 2) of nCount new slots or items,
+             *        only if any is waiting, otherwise a push or pop is a few stores
+             */
+            void Wake(size_t nTag, size_t nCount)
+            {
+                if ((nTag == 1 ? m_nPushWaiting : m_nPopWaiting) > 0)
+                {
+                    atomicx::GetCurrent()->Notify(*this, nTag, nCount > 1 ? NotifyType::all : NotifyType::one);
+                }
+            }
+
+            size_t m_nQSize;
+            size_t m_nItens;
+            uint16_t m_nPushWaiting = 0;
+            uint16_t m_nPopWaiting = 0;
+        };
+
+        /**
+         * ------------------------------
+         * THREAD POOL IMPLEMENTATION
+         * ------------------------------
+         */
+
+        /**
+         * @brief Free list of finished threads of type T, recycled along with their stack buffers
+         *
+         * @tparam T    Thread type, derived from atomicx, with a void Rearm(Args...) taking the
+         *              Spawn() arguments
+         *
+         * @note A pooled thread gives itself back calling Recycle(*this) from finish(), instead of
+         *       delete this, Detach() does the same as it calls finish(). Spawn() re-arms it like a
+         *       new thread, the kernel state (priority, nice, period, locks...) back to its defaults,
+         *       but the object is not constructed again: T::Rearm(args...) gets the arguments the
+         *       constructor would have, and per run state can also be set right after Spawn(), the
+         *       thread only starts on the next Yield of the caller.
+         *       The pool owns the threads Spawn() created and deletes those still in the free list
+         *       when it is destroyed, running ones must not outlive it. Statically allocated threads
+         *       can be given to it with Recycle() before Start(), they are never deleted.
+         */
+        template<typename T>
+        class threadPool
+        {
+        public:
+
+            ~threadPool()
+            {
+                while (m_pFree != nullptr)
+                {
+                    T* pThread = m_pFree;
+                    atomicx& thr = *pThread;
+
+                    m_pFree = static_cast<T*>(thr.m_paNext);
+                    thr.m_paNext = nullptr;
+                    m_nFree--;
+
+#if ! ATOMICX_NO_HEAP
+                    if (thr.m_flags.pooled)
+                    {
+                        delete pThread;
+                    }
+#endif
+                }
+            }
+
+            /**
+             * @brief Get a recycled thread, or a new one if the pool is empty
+             *
+             * @param args  Constructor arguments for new threads, T::Rearm() arguments for recycled ones
+             *
+             * @return T* The thread, ready to start, nullptr if the pool is empty with ATOMICX_NO_HEAP
+             */
+            template<typename... Args> T* Spawn(Args&&... args)
+            {
+                T* pThread = m_pFree;
+
+                if (pThread == nullptr)
+                {
+#if ATOMICX_NO_HEAP
+                    return nullptr;
+#else
+                    m_nCreated++;
+
+                    pThread = new T(static_cast<Args&&>(args)...);
+
+                    static_cast<atomicx&>(*pThread).m_flags.pooled = true;
+
+                    return pThread;
+#endif
+                }
+
+                atomicx& thr = *pThread;
+
+                m_pFree = static_cast<T*>(thr.m_paNext);
+                thr.m_paNext = nullptr;
+                m_nFree--;
+
+                thr.RearmThread ();
+
+                pThread->Rearm (static_cast<Args&&>(args)...);
+
+                return pThread;
+            }
+
+            /**
+             * @brief Give a thread back to the pool, it leaves the kernel keeping its stack buffer
+             *
+             * @param thread    The thread, it is ignored if it is not attached to the kernel
+             *
+             * @return true if it was added to the pool
+             */
+            bool Recycle(T& thread)
+            {
+                atomicx& thr = thread;
+
+                if (thr.m_flags.attached == false)
+                {
+                    return false;
+                }
+
+                thr.RecycleThread ();
+
+                // The thread list link is free while detached
+                thr.m_paNext = m_pFree;
+                m_pFree = &thread;
+                m_nFree++;
+
+                return true;
+            }
+
+            /**
+             * @brief Get the number of threads waiting in the pool
+             */
+            size_t GetFreeCount()
+            {
+                return m_nFree;
+            }
+
+            /**
+             * @brief Get the number of threads Spawn() had to create
+             */
+            size_t GetCreatedCount()
+            {
+                return m_nCreated;
+            }
+
+        private:
+            T* m_pFree = nullptr;
+            size_t m_nFree = 0;
+            size_t m_nCreated = 0;
+        };
+
+        /**
+         * --------------------------------
+         * SEMAPHORES IMPLEMENTATION
+         * --------------------------------
+         */
+
+        class semaphore
+        {
+            public:
                 /**
-                 * @brief Accquire a SharedLock
+                 * @brief Construct a new semaphore with MaxShared allowed
                  *
-                 * @return true if accquired, false if another accquisition was already done
+                 * @param nMaxShred     Max shared lock
                  */
-                bool SharedLock(atomicx_time ttimeout=0);
+                semaphore(size_t nMaxShared);
+
+                /**
+                 * @brief Acquire a shared lock context, if already on max shared allowed, wait till one is release or timeout
+                 *
+                 * @param nTimeout  default = 0 (indefinitely), How long to wait of accquiring
+                 *
+                 * @return true if it acquired the context, otherwise timeout returns false
+                 */
+                bool acquire(atomicx_time nTimeout = 0);
+
+                /**
+                 * @brief Releases one shared lock
+                 */
+                void release();
+
+                /**
+                 * @brief Get How many shared locks at a given moment
+                 *
+                 * @return size_t   Number of shared locks
+                 */
+                size_t GetCount();
+
+                /**
+                 * @brief Get how many waiting threads for accquiring context
+                 *
+                 * @return size_t   Number of waiting threads
+                 */
+                size_t GetWaitCount();
+
+                /**
+                 * @brief Get the Max Acquired Number
+                 *
+                 * @return size_t   The max acquired context number
+                 */
+                size_t GetMaxAcquired();
+
+                /**
+                 * @brief Get the maximun accquired context possible
+                 *
+                 * @return size_t
+                 */
+                static size_t GetMax ();
+
+            private:
+                size_t m_counter=0;
+                size_t m_maxShared;
+
+                // Holder of a binary semaphore, used for priority inheritance
+                atomicx* m_pOwner=nullptr;
+                heldLock m_held{this, nullptr};
+        };
+
+        class smartSemaphore
+        {
+            public:
+                /**
+                 * @brief Acquire and managed the semaphore
+                 *
+                 * @param sem   base semaphore
+                 */
+                smartSemaphore (atomicx::semaphore& sem);
+                smartSemaphore () = delete;
+                /**
+                 * @brief Destroy the smart Semaphore while releasing it
+                 */
+                ~smartSemaphore();
+
+                /**
+                 * @brief Acquire a shared lock context, if already on max shared allowed, wait till one is release or timeout
+                 *
+                 * @param nTimeout  default = 0 (indefinitely), How long to wait of accquiring
+                 *
+                 * @return true if it acquired the context, otherwise timeout returns false
+                 */
+                bool acquire(atomicx_time nTimeout = 0);
+
+                /**
+                 * @brief Releases one shared lock
+                 */
+                void release();
+
+                /**
+                 * @brief Get How many shared locks at a given moment
+                 *
+                 * @return size_t   Number of shared locks
+                 */
+                size_t GetCount();
+
+                /**
+                 * @brief Get how many waiting threads for accquiring context
+                 *
+                 * @return size_t   Number of waiting threads
+                 */
+                size_t GetWaitCount();
+
+                /**
+                 * @brief Get the Max Acquired Number
+                 *
+                 * @return size_t   The max acquired context number
+                 */
+                size_t GetMaxAcquired();
+
+                /**
+                 * @brief Get the maximun accquired context possible
+                 *
+                 * @return size_t
+                 */
+                static size_t GetMax ();
+
+                /**
+                 * @brief  Report if the smartSemaphore has acquired a shared context
+                 *
+                 * @return true if it has successfully acquired a shared context otherwise false
+                 */
+                bool IsAcquired ();
+
+            private:
+            semaphore& m_sem;
+            bool bAcquired = false;
+        };
+
+        /**
+         * ------------------------------
+         * SMART LOCK IMPLEMENTATION
+         * ------------------------------
+         */
+
+        /* The stamart mutex implementation */
+        class mutex
+        {
+        public:
+            /**
+             * @brief Exclusive/binary lock the smart lock
+             *
+             * @note Once Lock() methos is called, if any thread held a shared lock,
+             *       the Lock will wait for it to finish in order to acquire the exclusive
+             *       lock, and all other threads that needs to a shared lock will wait till
+             *       Lock is accquired and released.
+             */
+            bool Lock(atomicx_time ttimeout=0);
+
+            /**
+             * @brief Release the exclusive lock
+             */
+            void Unlock();
+
+            /**
+             * @brief Shared Lock for the smart Lock
+             *
+             * @note Shared lock can only be accquired if no Exclusive lock is waiting or already accquired a exclusive lock,
+             *       In contrast, if at least one thread holds a shared lock, any exclusive lock can only be accquired once it
+             *       is released.
+             */
+            bool SharedLock(atomicx_time ttimeout=0);
+
+            /**
+             * @brief Release the current shared lock
+             */
+            void SharedUnlock();
+
+            /**
+             * @brief Check how many shared locks are accquired
+             *
+             * @return size_t   Number of threads holding shared locks
+             */
+            size_t IsShared();
+
+            /**
+             * @brief Check if a exclusive lock has been already accquired
+             *
+             * @return true if yes, otherwise false
+             */
+            bool IsLocked();
+
+        protected:
+        private:
+            size_t nSharedLockCount=0;
+            bool bExclusiveLock=false;
+
+            // Exclusive lock holder, used for priority inheritance
+            atomicx* m_pOwner=nullptr;
+            heldLock m_held{&bExclusiveLock, nullptr};
+        };
+
+        /**
+         * @brief RII compliance lock/shared lock to auto unlock on destruction
+         *
+         */
+        class smartMutex
+        {
+            public:
+                smartMutex() = delete;
+
+                /**
+                 * @brief Construct a new Smart Lock object based a existing lock
+                 *
+                 * @param lockObj the existing lock object
+                 */
+                smartMutex (mutex& lockObj);
+
+                /**
+                 * @brief Destroy and release the smart lock taken
+                 */
+                ~smartMutex();
+
+                /**
+                 * @brief Accquire a SharedLock
+                 *
+                 * @return true if accquired, false if another accquisition was already done
+                 */
+                bool SharedLock(atomicx_time ttimeout=0);
+
+                /**
+                 * @brief Accquire a exclusive Lock
+                 *
+                 * @return true if accquired, false if another accquisition was already done
+                 */
+                bool Lock(atomicx_time ttimeout=0);
+
+                /**
+                 * @brief Check how many shared locks are accquired
+                 *
+                 * @return size_t   Number of threads holding shared locks
+                 */
+                size_t IsShared();
+
+                /**
+                 * @brief Check if a exclusive lock has been already accquired
+                 *
+                 * @return true if yes, otherwise false
+                 */
+                bool IsLocked();
+
+            private:
+
+            mutex& m_lock;
+            uint8_t m_lockType = '\0';
+        };
+
+        /**
+         * PUBLIC OBJECT METHOS
+         */
+
+        /**
+         * @brief virtual destructor of the atomicx
+         */
+        virtual ~atomicx(void);
+
+        /**
+         * @brief Get the Current thread in execution
+         *
+         * @return atomicx* thread
+         */
+        static atomicx* GetCurrent();
+
+        /**
+         * @brief Construct a new atomicx object and set initial auto stack and increase pace
+         *
+         * @param nStackSize            Initial Size of the stack
+         * @param nStackIncreasePace    defalt=1, The increase pace on each resize
+         */
+#if ATOMICX_AUTO_STACK == 0
+        atomicx(size_t nStackSize=0, int nStackIncreasePace=1) = delete;
+#else
+        atomicx(size_t nStackSize=0, int nStackIncreasePace=1);
+#endif
+
+        /**
+         * @brief Get the Thread pointer from a object
+         *
+         * @param threadId  The thread ID reference
+         *
+         * @return atomicx* nullprt if not found otherwise the pointer to the thread
+         *
+         * @note Walks all threads, and a thread created at the address of a gone one has its ID,
+         *       use GetThread(Handle) to look threads up often or safely
+         */
+        static atomicx* GetThread(size_t threadId);
+
+        /**
+         * @brief Get the Thread pointer from its handle, in constant time
+         *
+         * @param handle  The thread handle (GetHandle)
+         *
+         * @return atomicx* nullptr if the thread is gone (or the handle is not valid) otherwise the thread
+         */
+        static atomicx* GetThread(Handle handle);
+
+        /**
+         * @brief Get the current Thread reference object
+         * 
+         * @return atomicx&     Current thread reference object
+         */
+        atomicx& GetThread (void);
+        
+        /**
+         * @brief Once it is call the process blocks execution and start all threads
+         *
+         * @return false if it was destried by dead lock (all threads locked)
+         */
+        static bool Start(void);
+
+        /**
+         * @brief Report if the kernel is already running
+         * 
+         * @return true is thread::atomicx::start is running, otherwise false
+         */
+        static bool IsKernelRunning();
+
+#if ATOMICX_STACK_ARENA || ATOMICX_STACK_POOL
+        /**
+         * @brief Get the bytes of the stack arena currently holding saved stacks
+         *
+         * @return size_t size in bytes
+         */
+        static size_t GetStackArenaInUse();
+
+        /**
+         * @brief Get the bytes the stack arena has reserved from the heap, in use or free
+         *
+         * @return size_t size in bytes
+         */
+        static size_t GetStackArenaReserved();
+#endif
+
+#if ATOMICX_STACK_COPY_KERNELS
+        /**
+         * @brief Force the kernel used to copy stacks at every depth, by default Start() times
+         *        each kernel at 1, 2, 4 and 8 KB and copies with the fastest one for the depth
+         *
+         * @param kernel    atomicx::StackCopy kernel
+         *
+         * @return true if the CPU supports it and it is now in use, otherwise false
+         */
+        static bool SetStackCopy(StackCopy kernel);
+
+        /**
+         * @brief Get the kernel in use to copy a stack of a given depth
+         *
+         * @param nSize     Used stack size in bytes
+         *
+         * @return StackCopy the kernel
+         */
+        static StackCopy GetStackCopy(size_t nSize=0);
+#endif
+
+#if ATOMICX_STACK_COMPRESS
+        /**
+         * @brief Get the bytes the compressed stacks of parked threads currently take
+         *
+         * @return size_t size in bytes
+         */
+        static size_t GetStackCompressedSize();
+
+        /**
+         * @brief Get the bytes the compressed stacks of parked threads would take uncompressed
+         *
+         * @return size_t size in bytes
+         */
+        static size_t GetStackUncompressedSize();
+#endif
+
+#if ATOMICX_STACK_INCREMENTAL
+        /**
+         * @brief Get the stack bytes written by context switches (save and restore)
+         *
+         * @return size_t size in bytes
+         */
+        static size_t GetStackBytesCopied();
+
+        /**
+         * @brief Get the stack bytes context switches found unchanged and did not write
+         *
+         * @return size_t size in bytes
+         */
+        static size_t GetStackBytesSkipped();
+#endif
+
+        /**
+         * @brief Get the current thread ID
+         *
+         * @return size_t  Thread ID number
+         */
+        size_t GetID(void);
+
+        /**
+         * @brief Get the thread handle, it changes every time the thread is attached (threadPool)
+         *
+         * @return Handle  Thread handle, index 0xffff (GetThread returns nullptr) if the thread
+         *                 registry was full: more than ATOMICX_THREAD_SLOTS threads with
+         *                 ATOMICX_NO_HEAP, or the heap could not grow it
+         *
+         * @note Check GetHandleMisses() once all threads are created to catch an undersized table
+         */
+        Handle GetHandle(void);
+
+        /**
+         * @brief Count threads that got no registry slot, and so no valid handle
+         *
+         * @return size_t  Threads created while the registry was full and could not grow
+         */
+        static size_t GetHandleMisses(void);
+
+
+        /**
+         * @brief Get the Max Stack Size for the thread
+         *
+         * @return size_t size in bytes
+         */
+        size_t GetStackSize(void);
+
+        /**
+         * @brief Get the Nice the current thread
+         *
+         * @return  atomicx_time the number representing the nice and based on the ported tick
+         *          granularity.
+         */
+        atomicx_time GetNice(void);
+
+        /**
+         * @brief Get the Used Stack Size for the thread since the last context change cycle
+         *
+         * @return size_t size in bytes
+         */
+        size_t GetUsedStackSize(void);
+
+#if ATOMICX_STACK_PROFILE
+        /**
+         * @brief Get the highest stack use seen for the thread, with ATOMICX_DEDICATED_STACK it is
+         *        the deepest byte touched on the thread stack
+         *
+         * @return size_t size in bytes
+         */
+        size_t GetMaxUsedStackSize(void);
+
+        /**
+         * @brief Get the return address of the Yield call that saved the biggest stack
+         *
+         * @return void* code address (use addr2line or the map file to find it)
+         */
+        void* GetMaxUsedStackSite(void);
+
+        /**
+         * @brief Write the stack profile of all threads as a C header, comments with the high
+         *        water mark, call site and histogram of each thread and a define with the
+         *        recommended stack size (high water + ATOMICX_STACK_PROFILE_MARGIN %) per thread name
+         *
+         * @param pWrite    Called with each line of text, new line included
+         */
+        static void StackProfileReport(void (*pWrite)(const char* pszText));
+#endif
+
+        /**
+         * @brief Get the Current Tick using the ported tick granularity function
+         *
+         * @return atomicx_time based on the ported tick granularity
+         */
+        atomicx_time GetCurrentTick(void);
+
+        /**
+         * @brief Get the Name object
+         *
+         * @return const char* name in plain c string
+         *
+         * @name If GetName was not overloaded by the derived thread implementation
+         *       a standard name will be returned.
+         */
+        virtual const char* GetName(void);
+
+        /**
+         * @brief Get next moment in ported tick granularity the thread will be due to return
+         *
+         * @return atomicx_time based on the ported tick granularity
+         */
+        atomicx_time GetTargetTime(void);
+
+        /**
+         * @brief Get the current thread status
+         *
+         * @return int use atomicx::aTypes
+         */
+        int GetStatus(void);
+
+        /**
+         * @brief Get the current thread sub status
+         *
+         * @return int use atomicx::aTypes
+         */
+        int GetSubStatus(void);
+
+        /**
+         * @brief Get the Reference Lock last used to lock the thread
+         *
+         * @return size_t the lock_id (used my wait)
+         */
+        size_t GetReferenceLock(void);
+
+        /**
+         * @brief Get the last tag message posted
+         *
+         * @return size_t atomicx::message::tag value
+         */
+        size_t GetTagLock(void);
+
+        /**
+         * @brief Set the Nice of the thread
+         *
+         * @param nice in atomicx_time reference based on the ported tick granularity
+         */
+        void SetNice (atomicx_time nice);
+
+        /**
+         * @brief Construct a new atomicx thread
+         *
+         * @tparam T Stack memory page type
+         * @tparam N Stack memory page size
+         */
+        template<typename T, size_t N> atomicx(T (&stack)[N]) : m_context{}, m_stackSize{N}, m_stack((volatile uint8_t*) stack)
+        {
+#if ATOMICX_DEDICATED_STACK && ! ATOMICX_AUTO_STACK
+           static_assert (sizeof (stack) >= ATOMICX_DEDICATED_STACK_SIZE, "With ATOMICX_DEDICATED_STACK and no auto stacks the fixed stack is the native stack, it needs ATOMICX_DEDICATED_STACK_SIZE bytes");
+#endif
+           SetDefaultInitializations();
+        }
+
+        /**
+         * @brief Return if the current thread's stack memory is automatic
+         */
+        bool IsStackSelfManaged(void);
+
+        /**
+         * @brief Foce the context change explicitly
+         *
+         * @param nSleep  default is ATOMICX_TIME_MAX, otherwise it will override the nice and sleep for n custom tick granularity
+         *
+         * @return true if the context came back correctly, otherwise false
+         */
+        bool Yield(atomicx_time nSleep=ATOMICX_TIME_MAX);
+
+#if ATOMICX_TIMING_STATS
+        /**
+         * @brief Get the Last Execution of User Code
+         *
+         * @return atomicx_time
+         */
+        atomicx_time GetLastUserExecTime();
+#endif
+
+#if ATOMICX_AUTO_STACK
+        /**
+         * @brief Get the Stack Increase Pace value
+         */
+        size_t GetStackIncreasePace(void);
+#endif
+
+         /**
+         * @brief Trigger a high priority NOW, caution it will always execute before normal yield.
+         */
+        void YieldNow (void);
+
+#if ATOMICX_DYNAMIC_NICE
+        /**
+         * @brief Set the Dynamic Nice on and off
+         *
+         * @param status    True for on otherwsize off
+         */
+        void SetDynamicNice(bool status);
+
+        /**
+         * @brief Get Dynamic Nice status
+         *
+         * @return true if dynamic nice is on otherwise off
+         */
+        bool IsDynamicNiceOn();
+#endif
+
+        /**
+         * @brief Set the thread base priority, among runnable threads the highest priority is always
+         *        selected first, threads with the same priority run in FIFO order
+         *
+         * @param nPriority     0 (default and lowest) up to ATOMICX_PRIORITIES - 1, higher values are clamped
+         *
+         * @note While holding a mutex or a binary semaphore wanted by a higher priority thread, the
+         *       thread inherits the waiter priority till all its locks are released
+         */
+        void SetPriority(uint8_t nPriority);
+
+        /**
+         * @brief Get the thread effective priority
+         *
+         * @return uint8_t  The base priority or, if higher, the one inherited from a lock waiter
+         */
+        uint8_t GetPriority();
 
-                /**
-                 * @brief Accquire a exclusive Lock
-                 *
-                 * @return true if accquired, false if another accquisition was already done
-                 */
-                bool Lock(atomicx_time ttimeout=0);
+        /**
+         * @brief Get the thread base priority, as set by SetPriority
+         *
+         * @return uint8_t  The base priority
+         */
+        uint8_t GetBasePriority();
 
-                /**
-                 * @brief Check how many shared locks are accquired
-                 *
-                 * @return size_t   Number of threads holding shared locks
-                 */
-                size_t IsShared();
+        /**
+         * @brief Make the thread periodic, a job is released every nPeriod ticks starting now,
+         *        release times are absolute so execution time never accumulates as drift
+         *
+         * @param nPeriod       The period in ticks, 0 makes the thread non periodic again
+         * @param nDeadline     Relative deadline of each job, default 0 means the period itself
+         *
+         * @note With ATOMICX_SCHED_EDF, runnable periodic threads are selected by earliest
+         *       absolute deadline, before any non periodic thread
+         */
+        void SetPeriod(atomicx_time nPeriod, atomicx_time nDeadline = 0);
 
-                /**
-                 * @brief Check if a exclusive lock has been already accquired
-                 *
-                 * @return true if yes, otherwise false
-                 */
-                bool IsLocked();
+        /**
+         * @brief Get the thread period
+         *
+         * @return atomicx_time  The period in ticks, 0 if not periodic
+         */
+        atomicx_time GetPeriod();
 
-            private:
+        /**
+         * @brief Get the absolute deadline of the current periodic job
+         *
+         * @return atomicx_time  The deadline tick
+         */
+        atomicx_time GetDeadline();
 
-            mutex& m_lock;
-            uint8_t m_lockType = '\0';
-        };
+        /**
+         * @brief Finish the current periodic job and sleep till the next release
+         *
+         * @return true if the job finished within its deadline, otherwise false (a deadline miss),
+         *         also false if the thread is not periodic or not the current one
+         */
+        bool WaitNextPeriod();
 
         /**
-         * PUBLIC OBJECT METHOS
+         * @brief Get how many periodic jobs were finished
+         *
+         * @return size_t   Number of jobs
          */
+        size_t GetJobCount();
 
         /**
-         * @brief virtual destructor of the atomicx
+         * @brief Get how many periodic jobs finished after their deadline
+         *
+         * @return size_t   Number of deadline misses
          */
-        virtual ~atomicx(void);
+        size_t GetDeadlineMisses();
 
         /**
-         * @brief Get the Current thread in execution
+         * @brief Get the worst lateness (finish tick - deadline) of a periodic job
          *
-         * @return atomicx* thread
+         * @return atomicx_time  The max lateness in ticks
          */
-        static atomicx* GetCurrent();
+        atomicx_time GetMaxLateness();
 
         /**
-         * @brief Construct a new atomicx object and set initial auto stack and increase pace
+         * @brief Get the accumulated lateness of all late periodic jobs
          *
-         * @param nStackSize            Initial Size of the stack
-         * @param nStackIncreasePace    defalt=1, The increase pace on each resize
+         * @return atomicx_time  The total lateness in ticks
          */
-        atomicx(size_t nStackSize=0, int nStackIncreasePace=1);
+        atomicx_time GetTotalLateness();
 
+#if ATOMICX_SCHED_FAIR
         /**
-         * @brief Get the Thread pointer from a object
+         * @brief Set the thread fair share
          *
-         * @param threadId  The thread ID reference
+         * @param nShare    The share, ATOMICX_FAIR_SHARE by default, a thread with twice
+         *                  the share of another gets twice its CPU time when both are busy
+         */
+        void SetShare(size_t nShare);
+
+        /**
+         * @brief Get the thread fair share
          *
-         * @return atomicx* nullprt if not found otherwise the pointer to the thread
+         * @return size_t   The share
          */
-        static atomicx* GetThread(size_t threadId);
+        size_t GetShare();
 
         /**
-         * @brief Get the current Thread reference object
-         * 
-         * @return atomicx&     Current thread reference object
+         * @brief Get the thread virtual runtime, the weighted exec time accumulated so far
+         *
+         * @return atomicx_time  The virtual runtime
          */
-        atomicx& GetThread (void);
-        
+        atomicx_time GetVirtualRuntime();
+#endif
+
         /**
-         * @brief Once it is call the process blocks execution and start all threads
+         * @brief Return how many threads assigned
          *
-         * @return false if it was destried by dead lock (all threads locked)
+         * @return size_t number of assigned threads
          */
-        static bool Start(void);
+        size_t GetThreadCount();
 
         /**
-         * @brief Report if the kernel is already running
+         * @brief Atop current thread context
+         */
+        void Stop ();
+
+        /**
+         * @brief Report if the current thread is stopped 
          * 
-         * @return true is thread::atomicx::start is running, otherwise false
+         * @return true if stopped otherwise false
          */
-        static bool IsKernelRunning();
+        bool IsStopped ();
 
         /**
-         * @brief Get the current thread ID
+         * @brief If stooped resume current thread 
+         */
+        void Resume();
+
+        /**
+         * @brief Finish and detach the thread from the pool
+
+         * @return true successfully detached
+         */
+        bool Finish();
+
+        /**
+         * @brief Detach current thread from the thread controller
+         * 
+         * @return true if successful detached, otherwise zero
+         */
+        void Detach();
+
+        /**
+         * @brief Mark thread to be restarted, all ongoing procedures will be dropped, finish is also called
+         * 
+         * @return true if successful mask to restart, otherwise zero
+         */
+        void Restart();
+
+        /**
+         * @brief Return the pointer for the next thread
+         * 
+         * @return atomicx*  if next thread return pointer otherwise nullptr
+         */
+        atomicx* operator++ (void);
+
+   /**
+         * @brief Safely notify all Waits from a specific reference pointer along with a message without triggering context change
          *
-         * @return size_t  Thread ID number
+         * @tparam T        Type of the reference pointer
+         * @param nMessage  The size_t message to be sent
+         * @param refVar    The reference pointer used a a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
+         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
+         *                  refVar waiting thread will be notified.
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         *
+         * @return true     if at least one got notified, otherwise false.
          */
-        size_t GetID(void);
+        template<typename T> size_t SafeNotify(size_t& nMessage, T& refVar, size_t nTag,  NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        {
+            return SafeNotifier(nMessage, refVar, nTag, asubType, notifyAll);
+        }
+
+        /**
+         * @brief Notify all Waits from a specific reference pointer along with a message and trigger context change if at least one wait thread got notified
+         *
+         * @tparam T        Type of the reference pointer
+         * @param nMessage  The size_t message to be sent
+         * @param refVar    The reference pointer used a a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
+         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
+         *                  refVar waiting thread will be notified.
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         *
+         * @return true     if at least one got notified, otherwise false.
+         */
+        template<typename T> size_t Notify(size_t& nMessage, T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        {
+            size_t bRet = SafeNotify (nMessage, refVar, nTag, notifyAll, asubType);
+
+            if (bRet) Yield(0);
+
+            return bRet;
+        }
+
+        template<typename T> size_t Notify(size_t&& nMessage, T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        {
+            size_t bRet = SafeNotify (nMessage, refVar, nTag, notifyAll, asubType);
+
+            if (bRet) Yield(0);
+
+            return bRet;
+        }
+
+        /**
+         * @brief SYNC Waits for at least one Wait call for a given reference pointer along with a message and trigger context change
+         *
+         * @tparam T        Type of the reference pointer
+         * @param nMessage  The size_t message to be sent
+         * @param refVar    The reference pointer used a a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
+         * @param waitForWaitings default=0 (waiting for Waiting calls) othersize wait for Wait commands compatible with the paramenters (Sync call).
+         * @param notifyAll  default = false, and only the fist available refVar Waiting thread will be notified, if true all available
+         *                  refVar waiting thread will be notified.
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         *
+         * @return 0        if no thread gets notified or timeout otherwise how much threads notified
+         */
+        template<typename T> size_t SyncNotify(size_t& nMessage, T& refVar, size_t nTag, atomicx_time waitForWaitings=0, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        {
+            if (LookForWaitings (refVar, nTag, waitForWaitings) == false)
+            {
+                return 0;
+            }
+
+            size_t bRet = SafeNotify (nMessage, refVar, nTag, notifyAll, asubType);
+
+            if (bRet) Yield(0);
+
+            return bRet;
+        }
+
+        template<typename T> size_t SyncNotify(size_t&& nMessage, T& refVar, size_t nTag, atomicx_time waitForWaitings=0, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        {
+            if (LookForWaitings (refVar, nTag, waitForWaitings) == false)
+            {
+                return 0;
+            }
+
+            size_t bRet = SafeNotify (nMessage, refVar, nTag, notifyAll, asubType);
+
+            if (bRet) Yield(0);
+
+            return bRet;
+        }
+
+        /**
+         * @brief Safely notify all Waits from a specific reference pointer without triggering context change
+         *
+         * @tparam T        Type of the reference pointer
+         * @param refVar    The reference pointer used a a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
+         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
+         *                  refVar waiting thread will be notified.
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         *
+         * @return true     if at least one got notified, otherwise false.
+         */
+        template<typename T> size_t SafeNotify(T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        {
+             size_t message=0;
+             return SafeNotifier (message, refVar, nTag, asubType, notifyAll);
+        }
+
+        /**
+         * @brief SYNC Waits for at least one Wait call for a given reference pointer and trigger context change
+         *
+         * @tparam T        Type of the reference pointer
+         * @param refVar    The reference pointer used a a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
+         * @param waitForWaitings default=0 (waiting for Waiting calls) othersize wait for Wait commands compatible with the paramenters (Sync call).
+         * @param notifyAll      default = false, and only the fist available refVar Waiting thread will be notified, if true all available
+         *                  refVar waiting thread will be notified.
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         *
+         * @return true     if at least one got notified, otherwise false.
+         */
+        template<typename T> size_t SyncNotify(T& refVar, size_t nTag, atomicx_time waitForWaitings=0, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        {
+            if (LookForWaitings (refVar, nTag, waitForWaitings) == false)
+            {
+                return 0;
+            }
+
+            size_t bRet = SafeNotify(refVar, nTag, notifyAll, asubType);
 
+            if (bRet) Yield(0);
+
+            return bRet;
+        }
 
         /**
-         * @brief Get the Max Stack Size for the thread
+         * @brief Notify all Waits from a specific reference pointer and trigger context change if at least one wait thread got notified
          *
-         * @return size_t size in bytes
-         */
-        size_t GetStackSize(void);
-
-        /**
-         * @brief Get the Nice the current thread
+         * @tparam T        Type of the reference pointer
+         * @param refVar    The reference pointer used a a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
+         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
+         *                  refVar waiting thread will be notified.
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
          *
-         * @return  atomicx_time the number representing the nice and based on the ported tick
-         *          granularity.
+         * @return true     if at least one got notified, otherwise false.
          */
-        atomicx_time GetNice(void);
+        template<typename T> size_t Notify(T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        {
+            size_t bRet = SafeNotify(refVar, nTag, notifyAll, asubType);
 
-        /**
-         * @brief Get the Used Stack Size for the thread since the last context change cycle
-         *
-         * @return size_t size in bytes
-         */
-        size_t GetUsedStackSize(void);
+            if (bRet) Yield(0);
+
+            return bRet;
+        }
 
         /**
-         * @brief Get the Current Tick using the ported tick granularity function
-         *
-         * @return atomicx_time based on the ported tick granularity
+         * ------------------------------
+         * SMART WAIT/NOTIFY  IMPLEMENTATION
+         * ------------------------------
          */
-        atomicx_time GetCurrentTick(void);
 
         /**
-         * @brief Get the Name object
+         * @brief Sync with thread call for a wait (refVar,nTag)
          *
-         * @return const char* name in plain c string
+         * @tparam T        Type of the reference pointer
+         * @param refVar    The reference pointer
+         * @param nTag      The notification meaning
+         * @param waitFor   default=0, if 0 wait indefinitely, otherwise wait for custom tick granularity times
+         * @param hasAtleast define how minimal Wait calls to report true
+         * @param asubType  Type of the waits to look for, deafault == aSubType::wait
          *
-         * @name If GetName was not overloaded by the derived thread implementation
-         *       a standard name will be returned.
+         * @return true There is thread waiting for the given refVar/nTag
          */
-        virtual const char* GetName(void);
+        template<typename T> bool LookForWaitings(T& refVar, size_t nTag, size_t hasAtleast, Timeout waitFor, aSubTypes asubType = aSubTypes::wait)
+        {
+            while (waitFor.IsTimedout () == false && IsWaiting(refVar, nTag, hasAtleast, asubType) == false)
+            {
+                SetWaitParammeters (refVar, nTag, aSubTypes::look);
 
-        /**
-         * @brief Get next moment in ported tick granularity the thread will be due to return
-         *
-         * @return atomicx_time based on the ported tick granularity
-         */
-        atomicx_time GetTargetTime(void);
+                Yield(waitFor.GetRemaining ());
 
-        /**
-         * @brief Get the current thread status
-         *
-         * @return int use atomicx::aTypes
-         */
-        int GetStatus(void);
+                m_lockMessage = {0,0};
 
-        /**
-         * @brief Get the current thread sub status
-         *
-         * @return int use atomicx::aTypes
-         */
-        int GetSubStatus(void);
+                if (m_aSubStatus == aSubTypes::timeout)
+                {
+                    return false;
+                }
+            }
 
-        /**
-         * @brief Get the Reference Lock last used to lock the thread
-         *
-         * @return size_t the lock_id (used my wait)
-         */
-        size_t GetReferenceLock(void);
+            return (waitFor.IsTimedout ()) ? false : true;
+        }
 
         /**
-         * @brief Get the last tag message posted
+         * @brief Sync with thread call for a wait (refVar,nTag)
          *
-         * @return size_t atomicx::message::tag value
-         */
-        size_t GetTagLock(void);
-
-        /**
-         * @brief Set the Nice of the thread
+         * @tparam T        Type of the reference pointer
+         * @param refVar    The reference pointer
+         * @param nTag      The notification meaning
+         * @param waitFor   default=0, if 0 wait indefinitely, otherwise wait for custom tick granularity times
          *
-         * @param nice in atomicx_time reference based on the ported tick granularity
+         * @return true There is thread waiting for the given refVar/nTag
          */
-        void SetNice (atomicx_time nice);
+        template<typename T> bool LookForWaitings(T& refVar, size_t nTag, atomicx_time waitFor)
+        {
+            if (IsWaiting(refVar, nTag) == false)
+            {
+                SetWaitParammeters (refVar, nTag, aSubTypes::look);
+
+                Yield(waitFor);
+
+                m_lockMessage = {0,0};
+
+                if (m_aSubStatus == aSubTypes::timeout)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
 
         /**
-         * @brief Construct a new atomicx thread
+         * @brief Check if there are waiting threads for a given reference pointer and tag value
          *
-         * @tparam T Stack memory page type
-         * @tparam N Stack memory page size
+         * @tparam T        Type of the reference pointer
+         * @param refVar    The reference pointer used a a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         *
+         * @return true
+         *
+         * @note This is a powerful tool since it create layers of waiting within the same reference pointer
          */
-        template<typename T, size_t N> atomicx(T (&stack)[N]) : m_context{}, m_stackSize{N}, m_stack((volatile uint8_t*) stack)
+        template<typename T> bool IsWaiting(T& refVar, size_t nTag, size_t hasAtleast = 1, aSubTypes asubType = aSubTypes::wait)
         {
-           SetDefaultInitializations();
-        }
+            hasAtleast = hasAtleast == 0 ? 1 : hasAtleast;
 
-        /**
-         * @brief Return if the current thread's stack memory is automatic
-         */
-        bool IsStackSelfManaged(void);
+            if (HasWaitings (refVar, nTag, asubType)>=hasAtleast)
+            {
+                return true;
+            }
+
+            return false;
+        }
 
         /**
-         * @brief Foce the context change explicitly
+         * @brief Report how much waiting threads for a given reference pointer and tag value are there
          *
-         * @param nSleep  default is ATOMICX_TIME_MAX, otherwise it will override the nice and sleep for n custom tick granularity
+         * @tparam T        Type of the reference pointer
+         * @param refVar    The reference pointer used a a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
          *
-         * @return true if the context came back correctly, otherwise false
+         * @return true
+         *
+         * @note This is a powerful tool since it create layers of waiting within the same reference pointer
          */
-        bool Yield(atomicx_time nSleep=ATOMICX_TIME_MAX);
+        template<typename T> size_t HasWaitings(T& refVar, size_t nTag, aSubTypes asubType = aSubTypes::wait)
+        {
+            size_t nCounter = 0;
+
+            for (atomicx* pThr = GetWaitQueue (&refVar); pThr != nullptr; pThr = pThr->m_pWaitNext)
+            {
+                if (IsNotificationEligible (*pThr, refVar, nTag, asubType))
+                {
+                    nCounter++;
+                }
+            }
+
+            return nCounter;
+        }
 
         /**
-         * @brief Get the Last Execution of User Code
+         * @brief Blocks/Waits a notification along with a message and tag from a specific reference pointer
          *
-         * @return atomicx_time
+         * @tparam T        Type of the reference pointer
+         * @param nMessage  the size_t message to be received
+         * @param refVar    the reference pointer used as a notifier
+         * @param nTag      the size_t tag that will give meaning to the the message
+         * @param waitFor   default==0 (indefinitely), How log to wait for a notification based on atomicx_time
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         * @return true if it was successfully received.
+         * 
+         * @note if tag is set to zero Waits will return false on call.
          */
-        atomicx_time GetLastUserExecTime();
+        template<typename T> bool Wait(size_t& nMessage, T& refVar, size_t nTag, atomicx_time waitFor=0, aSubTypes asubType = aSubTypes::wait)
+        {
+            if (nTag == 0 ) return false; 
 
-        /**
-         * @brief Get the Stack Increase Pace value
-         */
-        size_t GetStackIncreasePace(void);
+            SafeNotifyLookWaitings(refVar, nTag);
 
-         /**
-         * @brief Trigger a high priority NOW, caution it will always execute before normal yield.
-         */
-        void YieldNow (void);
+            SetWaitParammeters (refVar, nTag, asubType);
+
+            m_lockMessage.tag = nTag;
+
+            Yield(waitFor);
+
+            bool bRet = false;
+
+            if (m_aSubStatus != aSubTypes::timeout)
+            {
+                nMessage = m_lockMessage.message;
+                bRet = true;
+            }
+
+            m_lockMessage = {0,0};
+
+            m_aSubStatus = aSubTypes::ok;
+
+            return bRet;
+        }
 
         /**
-         * @brief Set the Dynamic Nice on and off
+         * @brief Blocks/Waits a notification along with a tag from a specific reference pointer
          *
-         * @param status    True for on otherwsize off
+         * @tparam T        Type of the reference pointer
+         * @param refVar    the reference pointer used as a notifier
+         * @param nTag      the size_t tag that will give meaning to the the message, if nTag == 0 means wait all refVar regardless
+         * @param waitFor   default==0 (indefinitely), How log to wait for a notification based on atomicx_time
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         *
+         * @return true if it was successfully received.
          */
-        void SetDynamicNice(bool status);
+        template<typename T> bool Wait(T& refVar, size_t nTag, atomicx_time waitFor=0, aSubTypes asubType = aSubTypes::wait)
+        {
+            size_t nMessage = 0;
 
+            return Wait (nMessage, refVar, nTag, waitFor, asubType);
+        }
+        
         /**
-         * @brief Get Dynamic Nice status
+         * @brief Blocks/Waits for any notification from a specific reference pointer and reports message and tag
          *
-         * @return true if dynamic nice is on otherwise off
+         * @tparam T        Type of the reference pointer
+         * @param nMessage  return ref size_t message received
+         * @param refVar    the reference pointer used as a notifier
+         * @param nTag      return ref size_t tag that will give meaning to the the message
+         * @param waitFor   default==0 (indefinitely), How log to wait for a notification based on atomicx_time
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         * @return true if it was successfully received.
          */
-        bool IsDynamicNiceOn();
+        template<typename T> bool WaitAny(size_t& nMessage, T& refVar, size_t& nTag, atomicx_time waitFor=0, aSubTypes asubType = aSubTypes::wait)
+        {
+            nTag = 0;
+
+            SafeNotifyLookWaitings(refVar, nTag);
+
+            SetWaitParammeters (refVar, nTag, asubType);
 
-        /**
-         * @brief Return how many threads assigned
-         *
-         * @return size_t number of assigned threads
-         */
-        size_t GetThreadCount();
+            Yield(waitFor);
 
-        /**
-         * @brief Atop current thread context
-         */
-        void Stop ();
+            bool bRet = false;
 
-        /**
-         * @brief Report if the current thread is stopped 
-         * 
-         * @return true if stopped otherwise false
-         */
-        bool IsStopped ();
+            if (m_aSubStatus != aSubTypes::timeout)
+            {
+                nMessage = m_lockMessage.message;
+                nTag = m_lockMessage.tag;
+                
+                bRet = true;
+            }
 
-        /**
-         * @brief If stooped resume current thread 
-         */
-        void Resume();
+            m_lockMessage = {0,0};
 
-        /**
-         * @brief Finish and detach the thread from the pool
+            m_aSubStatus = aSubTypes::ok;
 
-         * @return true successfully detached
-         */
-        bool Finish();
+            return bRet;
+        }
 
         /**
-         * @brief Detach current thread from the thread controller
-         * 
-         * @return true if successful detached, otherwise zero
+         * @brief Blocks/Waits for any notification from a specific reference pointer and also return the tag
+         *
+         * @tparam T        Type of the reference pointer
+         * @param refVar    the reference pointer used as a notifier
+         * @param nTag      return ref size_t tag that will give meaning to the the message
+         * @param waitFor   default==0 (indefinitely), How log to wait for a notification based on atomicx_time
+         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
+         *                  type of wait/notify, deafault == aSubType::wait
+         *
+         * @return true if it was successfully received.
          */
-        void Detach();
+        template<typename T> bool WaitAny(T& refVar, size_t& nTag, atomicx_time waitFor=0, aSubTypes asubType = aSubTypes::wait)
+        {
+            size_t nMessage = 0;
+            
+            return WaitAny (nMessage, refVar, nTag, waitFor, asubType);
+        }
 
+#if ATOMICX_PAYLOAD_SIZE
         /**
-         * @brief Mark thread to be restarted, all ongoing procedures will be dropped, finish is also called
-         * 
-         * @return true if successful mask to restart, otherwise zero
+         * ------------------------------
+         * PAYLOAD WAIT/NOTIFY IMPLEMENTATION
+         * ------------------------------
          */
-        void Restart();
 
         /**
-         * @brief Return the pointer for the next thread
-         * 
-         * @return atomicx*  if next thread return pointer otherwise nullptr
-         */
-        atomicx* operator++ (void);
-
-   /**
-         * @brief Safely notify all Waits from a specific reference pointer along with a message without triggering context change
+         * @brief Blocks/Waits a notification carrying a payload from a specific reference pointer
          *
          * @tparam T        Type of the reference pointer
-         * @param nMessage  The size_t message to be sent
-         * @param refVar    The reference pointer used a a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
-         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
-         *                  refVar waiting thread will be notified.
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
+         * @tparam P        Payload type, trivially copyable, up to ATOMICX_PAYLOAD_SIZE bytes
+         * @param payload   Receives the payload
+         * @param refVar    the reference pointer used as a notifier
+         * @param nTag      the size_t tag that will give meaning to the the payload
+         * @param waitFor   default==0 (indefinitely), How log to wait for a notification based on atomicx_time
          *
-         * @return true     if at least one got notified, otherwise false.
+         * @return true if a payload of sizeof (P) was received, false on timeout or if woken
+         *         without one (plain Notify or another payload type)
+         *
+         * @note The notifier copies the payload into this thread control block, it is copied out
+         *       to payload when the thread resumes, no shared state is involved
          */
-        template<typename T> size_t SafeNotify(size_t& nMessage, T& refVar, size_t nTag,  NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        template<typename T, typename P> bool WaitPayload(P& payload, T& refVar, size_t nTag, atomicx_time waitFor=0)
         {
-            return SafeNotifier(nMessage, refVar, nTag, asubType, notifyAll);
+            static_assert (sizeof (P) <= ATOMICX_PAYLOAD_SIZE, "Payload larger than ATOMICX_PAYLOAD_SIZE");
+
+            size_t nSize = 0;
+
+            // Delivered by a payload notifier, the notification message is the payload size
+            if (Wait (nSize, refVar, nTag, waitFor) == false || m_flags.payloadReceived == false || nSize != sizeof (P))
+            {
+                return false;
+            }
+
+            memcpy ((void*) &payload, (const void*) m_aPayload, sizeof (P));
+
+            return true;
         }
 
         /**
-         * @brief Notify all Waits from a specific reference pointer along with a message and trigger context change if at least one wait thread got notified
+         * @brief Safely notify WaitPayload calls from a specific reference pointer with a payload without triggering context change
          *
          * @tparam T        Type of the reference pointer
-         * @param nMessage  The size_t message to be sent
+         * @tparam P        Payload type, trivially copyable, up to ATOMICX_PAYLOAD_SIZE bytes
+         * @param payload   The payload, copied into each notified thread
          * @param refVar    The reference pointer used a a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
-         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
-         *                  refVar waiting thread will be notified.
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
+         * @param nTag      The size_t tag that will give meaning to the payload
+         * @param notifyAll default = one, only the fist available refVar Waiting thread will be notified
          *
-         * @return true     if at least one got notified, otherwise false.
+         * @return size_t   Number of notified threads
          */
-        template<typename T> size_t Notify(size_t& nMessage, T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        template<typename T, typename P> size_t SafeNotifyPayload(const P& payload, T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one)
         {
-            size_t bRet = SafeNotify (nMessage, refVar, nTag, notifyAll, asubType);
+            static_assert (sizeof (P) <= ATOMICX_PAYLOAD_SIZE, "Payload larger than ATOMICX_PAYLOAD_SIZE");
 
-            if (bRet) Yield(0);
+            size_t nSize = sizeof (P);
 
-            return bRet;
+            return SafeNotifier (nSize, refVar, nTag, aSubTypes::wait, notifyAll, (const void*) &payload);
         }
 
-        template<typename T> size_t Notify(size_t&& nMessage, T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        /**
+         * @brief Notify WaitPayload calls with a payload and trigger context change if at least one got notified
+         *
+         * @return size_t   Number of notified threads
+         */
+        template<typename T, typename P> size_t NotifyPayload(const P& payload, T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one)
         {
-            size_t bRet = SafeNotify (nMessage, refVar, nTag, notifyAll, asubType);
+            size_t nRet = SafeNotifyPayload (payload, refVar, nTag, notifyAll);
 
-            if (bRet) Yield(0);
+            if (nRet) Yield(0);
 
-            return bRet;
+            return nRet;
         }
 
         /**
-         * @brief SYNC Waits for at least one Wait call for a given reference pointer along with a message and trigger context change
+         * @brief Wait for a WaitPayload call on (refVar, nTag) and notify it with a payload
          *
-         * @tparam T        Type of the reference pointer
-         * @param nMessage  The size_t message to be sent
-         * @param refVar    The reference pointer used a a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
-         * @param waitForWaitings default=0 (waiting for Waiting calls) othersize wait for Wait commands compatible with the paramenters (Sync call).
-         * @param notifyAll  default = false, and only the fist available refVar Waiting thread will be notified, if true all available
-         *                  refVar waiting thread will be notified.
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
+         * @param waitForWaitings   default=0, if 0 wait indefinitely for a waiting thread
          *
-         * @return 0        if no thread gets notified or timeout otherwise how much threads notified
+         * @return size_t   Number of notified threads, 0 if none was waiting in time
          */
-        template<typename T> size_t SyncNotify(size_t& nMessage, T& refVar, size_t nTag, atomicx_time waitForWaitings=0, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        template<typename T, typename P> size_t SyncNotifyPayload(const P& payload, T& refVar, size_t nTag, atomicx_time waitForWaitings=0, NotifyType notifyAll=NotifyType::one)
         {
             if (LookForWaitings (refVar, nTag, waitForWaitings) == false)
             {
                 return 0;
             }
 
-            size_t bRet = SafeNotify (nMessage, refVar, nTag, notifyAll, asubType);
+            return NotifyPayload (payload, refVar, nTag, notifyAll);
+        }
+#endif
 
-            if (bRet) Yield(0);
+#if ATOMICX_BROADCAST
+        /**
+         * ------------------------------
+         * MESSAGE BROADCAST IMPLEMENTATION
+         * Public part for the implementation
+         * ------------------------------
+         */
 
-            return bRet;
-        }
+        /**
+         * @brief Broadcast a message to all threads, calls BroadcastHandler of every thread that
+         *        opted in with SetReceiveBroadcast, from the sender
+         *
+         * @param messageReference Works as the signaling
+         * @param message   Message structure with the message
+         *                  message is the payload
+         *                  tag is the meaning
+         *
+         * @return size_t   Number of receivers
+         */
+        size_t BroadcastMessage (const size_t messageReference, const Message message);
+#endif
 
-        template<typename T> size_t SyncNotify(size_t&& nMessage, T& refVar, size_t nTag, atomicx_time waitForWaitings=0, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        /**
+         *   SEND AND RECEIVE DATA USING DATA PIPES 
+         *   to 1 to many
+         */
+        
+        enum class TransferState : uint8_t
         {
-            if (LookForWaitings (refVar, nTag, waitForWaitings) == false)
+            ready=10,
+            start=11,
+            transfering=12,
+            end=13
+        };
+
+        typedef size_t tranfer_t;
+        
+        template<typename T> uint16_t Send (T& refVar, uint8_t* pData, uint16_t nDataSize, Timeout timeout)
+        {
+            size_t nReceivers = 0;
+
+            if (pData == nullptr || nDataSize == 0) return 0;
+
+            // Starting
+            if ((nReceivers = SyncNotify (nDataSize, refVar, (size_t) TransferState::start, timeout.GetRemaining ())) == 0)
             {
+                // There is no reader listening the same refVar
                 return 0;
             }
 
-            size_t bRet = SafeNotify (nMessage, refVar, nTag, notifyAll, asubType);
+            uint8_t nMessage [sizeof (tranfer_t)];
+            const uint8_t nPayloadSize = sizeof (tranfer_t)-1;
+            uint16_t nDataSent = 0;
+            
+            // Transfering
+            while (nDataSize && ! timeout.IsTimedout ())
+            {
+                 nMessage [0] = nDataSize < (nPayloadSize) ? nDataSize : nPayloadSize;
+                                             
+                if (! (memcpy ((void*) &nMessage[1], pData, nMessage [0]) != nullptr 
+                   && LookForWaitings(refVar, (size_t) TransferState::transfering, (size_t) nReceivers, timeout.GetRemaining ())
+                   && ! timeout.IsTimedout ()
+                   && SyncNotify (*((size_t*) nMessage), refVar, (size_t) TransferState::transfering, timeout.GetRemaining ())))
+                {
+                    return 0;
+                }
 
-            if (bRet) Yield(0);
+                nDataSize -= (size_t) nMessage [0];
+                pData += (size_t) nMessage [0];
+                nDataSent += (size_t) nMessage [0];
+            }
 
-            return bRet;
+            // Finishing
+            if (! (! timeout.IsTimedout () && LookForWaitings(refVar, (size_t) TransferState::transfering, (size_t) nReceivers, timeout.GetRemaining ()) && ! timeout.IsTimedout ()
+                && SyncNotify (nDataSent, refVar, (size_t) TransferState::end, timeout.GetRemaining ())))
+            {
+                return 0;
+            }
+
+            return nDataSent;
         }
 
-        /**
-         * @brief Safely notify all Waits from a specific reference pointer without triggering context change
-         *
-         * @tparam T        Type of the reference pointer
-         * @param refVar    The reference pointer used a a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
-         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
-         *                  refVar waiting thread will be notified.
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
-         *
-         * @return true     if at least one got notified, otherwise false.
-         */
-        template<typename T> size_t SafeNotify(T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        template<typename T> uint16_t Receive (T& refVar, uint8_t* pData, uint16_t nDataSize, Timeout timeout)
         {
-             size_t message=0;
-             return SafeNotifier (message, refVar, nTag, asubType, notifyAll);
+            size_t nMessage = 0;
+            size_t nTag = 0;
+            TransferState state = TransferState::ready;
+        
+            uint8_t  nWriteLen = 0;
+            uint16_t nReceivedLen = 0;
+
+            if (pData == nullptr || nDataSize == 0) return 0;
+
+            while (! timeout.IsTimedout () && WaitAny (nMessage, refVar, nTag, timeout.GetRemaining ()))
+            {
+                //Wait to start
+                if (state  == TransferState::ready)
+                {
+                    if ((TransferState) nTag == TransferState::start)
+                    {
+                        state = TransferState::transfering;
+                    }
+                    else
+                    {
+                        continue;
+                    }
+                }
+                else if (state == TransferState::transfering && state == (TransferState) nTag && nReceivedLen < nDataSize) // transfering
+                {
+                    // Transfering
+                    uint8_t* nPayload = (uint8_t*) &nMessage;
+                    nWriteLen = (nReceivedLen + nPayload [0]) > nDataSize ? (nDataSize - nReceivedLen) : nPayload [0];
+
+                    if (memcpy (pData, &nPayload[1], nWriteLen) == nullptr)
+                    {
+                        return 0;
+                    }
+
+                    pData += nPayload [0];
+                    nReceivedLen += nPayload [0];
+                }
+                else if (state == TransferState::transfering && (TransferState) nTag == TransferState::end)
+                {
+                    // Ending
+                    break;
+                }
+            }
+            
+            return timeout.IsTimedout () ? 0 : nReceivedLen;
         }
 
         /**
-         * @brief SYNC Waits for at least one Wait call for a given reference pointer and trigger context change
+         * @brief Bulk send, copies pData straight into the buffer of a thread waiting in
+         *        ReceiveBulk on refVar: one rendezvous and one memcpy whatever the size
          *
          * @tparam T        Type of the reference pointer
-         * @param refVar    The reference pointer used a a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
-         * @param waitForWaitings default=0 (waiting for Waiting calls) othersize wait for Wait commands compatible with the paramenters (Sync call).
-         * @param notifyAll      default = false, and only the fist available refVar Waiting thread will be notified, if true all available
-         *                  refVar waiting thread will be notified.
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
+         * @param refVar    The reference pointer used as the channel
+         * @param pData     Data to send, only read during the call
+         * @param nDataSize Data size
+         * @param timeout   How long to wait for a receiver, Timeout(0) waits indefinitely
          *
-         * @return true     if at least one got notified, otherwise false.
+         * @return size_t   Bytes delivered, less than nDataSize if the receiver buffer is
+         *                  smaller, 0 if no receiver showed up in time
          */
-        template<typename T> size_t SyncNotify(T& refVar, size_t nTag, atomicx_time waitForWaitings=0, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        template<typename T> size_t SendBulk (T& refVar, const uint8_t* pData, size_t nDataSize, Timeout timeout)
         {
-            if (LookForWaitings (refVar, nTag, waitForWaitings) == false)
+            Segment segment = {pData, nDataSize};
+
+            if (pData == nullptr || nDataSize == 0)
             {
                 return 0;
             }
 
-            size_t bRet = SafeNotify(refVar, nTag, notifyAll, asubType);
-
-            if (bRet) Yield(0);
-
-            return bRet;
+            return SendV (refVar, &segment, 1, timeout);
         }
 
         /**
-         * @brief Notify all Waits from a specific reference pointer and trigger context change if at least one wait thread got notified
+         * @brief Scatter/gather bulk send, gathers the segments straight into the buffer of a
+         *        thread waiting in ReceiveBulk on refVar
          *
          * @tparam T        Type of the reference pointer
-         * @param refVar    The reference pointer used a a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification, if nTag == 0 means notify all refVar regardless
-         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
-         *                  refVar waiting thread will be notified.
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
+         * @param refVar    The reference pointer used as the channel
+         * @param pSegments Segments of the message, in order, only read during the call
+         * @param nSegments Number of segments
+         * @param timeout   How long to wait for a receiver, Timeout(0) waits indefinitely
          *
-         * @return true     if at least one got notified, otherwise false.
+         * @return size_t   Bytes delivered, 0 if no receiver showed up in time
          */
-        template<typename T> size_t Notify(T& refVar, size_t nTag, NotifyType notifyAll=NotifyType::one, aSubTypes asubType = aSubTypes::wait)
+        template<typename T> size_t SendV (T& refVar, const Segment* pSegments, size_t nSegments, Timeout timeout)
         {
-            size_t bRet = SafeNotify(refVar, nTag, notifyAll, asubType);
+            Delivery delivery = {nullptr, 0};
 
-            if (bRet) Yield(0);
+            SendV (refVar, pSegments, nSegments, &delivery, 1, timeout);
 
-            return bRet;
+            return delivery.nSize;
         }
 
         /**
-         * ------------------------------
-         * SMART WAIT/NOTIFY  IMPLEMENTATION
-         * ------------------------------
-         */
-
-        /**
-         * @brief Sync with thread call for a wait (refVar,nTag)
+         * @brief Fan-out scatter/gather bulk send, delivers the message to up to nReceivers
+         *        threads waiting in ReceiveBulk on refVar, one copy into each receiver buffer
          *
-         * @tparam T        Type of the reference pointer
-         * @param refVar    The reference pointer
-         * @param nTag      The notification meaning
-         * @param waitFor   default=0, if 0 wait indefinitely, otherwise wait for custom tick granularity times
-         * @param hasAtleast define how minimal Wait calls to report true
+         * @tparam T            Type of the reference pointer
+         * @param refVar        The reference pointer used as the channel
+         * @param pSegments     Segments of the message, in order, only read during the call
+         * @param nSegments     Number of segments
+         * @param pDeliveries   Receives one result per receiver, in delivery order
+         * @param nReceivers    Receivers to deliver to, size of pDeliveries
+         * @param timeout       How long to wait for the receivers, Timeout(0) waits indefinitely
          *
-         * @return true There is thread waiting for the given refVar/nTag
+         * @return size_t   Number of receivers served, the other pDeliveries are {nullptr, 0}
+         *
+         * @note Receivers already waiting are served at once and the others as they arrive,
+         *       a slow receiver only delays the sender up to timeout, not the other receivers.
+         *       A receiver gets the message once even if it waits again during the call.
          */
-        template<typename T> bool LookForWaitings(T& refVar, size_t nTag, size_t hasAtleast, Timeout waitFor)
+        template<typename T> size_t SendV (T& refVar, const Segment* pSegments, size_t nSegments, Delivery* pDeliveries, size_t nReceivers, Timeout timeout)
         {
-            while (waitFor.IsTimedout () == false && IsWaiting(refVar, nTag, hasAtleast) == false)
+            size_t nServed = 0;
+
+            if (pSegments == nullptr || nSegments == 0 || pDeliveries == nullptr)
             {
-                SetWaitParammeters (refVar, nTag, aSubTypes::look);
+                return 0;
+            }
 
-                Yield(waitFor.GetRemaining ());
+            while (nServed < nReceivers)
+            {
+                size_t nBefore = nServed;
 
-                m_lockMessage = {0,0};
+                nServed = TransferTo (&refVar, pSegments, nSegments, pDeliveries, nServed, nReceivers);
 
-                if (m_aSubStatus == aSubTypes::timeout)
+                if (nServed == nBefore)
                 {
-                    return false;
+                    // No new receiver waiting, look until one comes or it times out
+                    atomicx_time nRemaining = timeout.GetRemaining ();
+
+                    if (timeout.IsTimedout ())
+                    {
+                        break;
+                    }
+
+                    SetWaitParammeters (refVar, 0, aSubTypes::look);
+
+                    Yield(nRemaining);
+
+                    m_lockMessage = {0,0};
+
+                    if (m_aSubStatus == aSubTypes::timeout)
+                    {
+                        break;
+                    }
                 }
             }
 
-            return (waitFor.IsTimedout ()) ? false : true;
+            for (size_t nIndex = nServed; nIndex < nReceivers; nIndex++)
+            {
+                pDeliveries [nIndex] = {nullptr, 0};
+            }
+
+            if (nServed) Yield(0);
+
+            return nServed;
         }
 
         /**
-         * @brief Sync with thread call for a wait (refVar,nTag)
+         * @brief Bulk receive, lends pData to the next SendBulk on refVar, which copies
+         *        the data into it directly
          *
          * @tparam T        Type of the reference pointer
-         * @param refVar    The reference pointer
-         * @param nTag      The notification meaning
-         * @param waitFor   default=0, if 0 wait indefinitely, otherwise wait for custom tick granularity times
+         * @param refVar    The reference pointer used as the channel
+         * @param pData     Receiving buffer
+         * @param nDataSize Receiving buffer size
+         * @param timeout   How long to wait for a sender, Timeout(0) waits indefinitely
          *
-         * @return true There is thread waiting for the given refVar/nTag
+         * @return size_t   Bytes received, 0 on timeout or if pData is on the thread stack
+         *
+         * @note The sender writes pData while this thread is parked, with the stack copy
+         *       backend the parked stack is not in place, so pData must not be on the thread
+         *       stack: use a static, heap or thread member buffer. Any buffer works with
+         *       ATOMICX_DEDICATED_STACK.
          */
-        template<typename T> bool LookForWaitings(T& refVar, size_t nTag, atomicx_time waitFor)
+        template<typename T> size_t ReceiveBulk (T& refVar, uint8_t* pData, size_t nDataSize, Timeout timeout)
         {
-            if (IsWaiting(refVar, nTag) == false)
+            if (pData == nullptr || nDataSize == 0 || timeout.IsTimedout () || IsOnThreadStack (pData))
             {
-                SetWaitParammeters (refVar, nTag, aSubTypes::look);
+                return 0;
+            }
 
-                Yield(waitFor);
+            SafeNotifyLookWaitings(refVar, 0);
 
-                m_lockMessage = {0,0};
+            // While parked the tag holds the buffer size and the message the buffer
+            SetWaitParammeters (refVar, nDataSize, aSubTypes::transfer);
 
-                if (m_aSubStatus == aSubTypes::timeout)
-                {
-                    return false;
-                }
-            }
+            m_lockMessage.message = (size_t) pData;
 
-            return true;
+            Yield(timeout.GetRemaining ());
+
+            size_t nReceived = m_aSubStatus != aSubTypes::timeout ? m_lockMessage.message : 0;
+
+            m_lockMessage = {0,0};
+
+            m_aSubStatus = aSubTypes::ok;
+
+            return nReceived;
         }
 
+    /**
+     *  PROTECTED METHODS, THOSE WILL BE ONLY ACCESSIBLE BY THE THREAD ITSELF
+     */
+    protected:
+
         /**
-         * @brief Check if there are waiting threads for a given reference pointer and tag value
+         * @brief The pure virtual function that runs the thread loop
          *
-         * @tparam T        Type of the reference pointer
-         * @param refVar    The reference pointer used a a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
+         * @note REQUIRED implementation and once it returns it will execute finish method
+         */
+        virtual void run(void) noexcept = 0;
+
+        /**
+         * @brief Handles the StackOverflow of the current thread
          *
-         * @return true
+         * @note REQUIRED
+         */
+        virtual void StackOverflowHandler(void) noexcept = 0;
+
+        /**
+         * @brief Called right after run returns, can be used to self-destroy the object and other maintenance actions
          *
-         * @note This is a powerful tool since it create layers of waiting within the same reference pointer
+         * @note if not implemented a default "empty" call is used instead
          */
-        template<typename T> bool IsWaiting(T& refVar, size_t nTag, size_t hasAtleast = 1, aSubTypes asubType = aSubTypes::wait)
-        {
-            hasAtleast = hasAtleast == 0 ? 1 : hasAtleast;
+        virtual void finish() noexcept;
 
-            if (HasWaitings (refVar, nTag, asubType)>=hasAtleast)
+#if ATOMICX_BROADCAST
+        /**
+         * ------------------------------
+         * MESSAGE BROADCAST IMPLEMENTATION
+         * ------------------------------
+         */
+
+         /**
+         * @brief The default broadcast handler used to received the message
+         * 
+         * @param messageReference Works as the signaling
+         * @param message   Message structure with the message
+         *                  message is the payload
+         *                  tag is the meaning
+         */
+        virtual void BroadcastHandler (const size_t& messageReference, const Message& message);
+        
+        /**
+         * @brief Enable or Disable async broadcast 
+         * 
+         * @param bBroadcastStatus   if true, the thread will receive broadcast otherwise no
+         */
+        void SetReceiveBroadcast (bool bBroadcastStatus);
+#endif
+
+#if ATOMICX_AUTO_STACK
+        /**
+         * @brief Set the Stack Increase Pace object
+         *
+         * @param nIncreasePace The new stack increase pace value
+         */
+        void SetStackIncreasePace(size_t nIncreasePace);
+#endif
+
+
+        /**
+         *  SPECIAL PRIVATE SECTION FOR HELPER METHODS USED BY PROCTED METHODS
+         */
+    private:
+
+        friend struct policy::base;
+
+        /**
+         * @brief Report is the current thread, refVar, ntag and subType is eligible to receive a notification 
+         * 
+         * @tparam T        the object used as the reference pointer
+         * @param thr       The thread to be notified
+         * @param refVar    The reference pointer used as a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification
+         * @param subType   The subtype of the type::wait
+         * 
+         * @return false    if the current thread can not be notified with the given configuration, otherwise true
+         */
+        template<typename T> bool IsNotificationEligible (atomicx& thr, T& refVar, size_t nTag, aSubTypes subType)
+        {
+            if (thr.m_aSubStatus == subType &&
+                thr.m_aStatus == aTypes::wait &&
+                thr.m_pLockId == (void*) &refVar &&
+                (nTag == 0 || thr.m_lockMessage.tag == 0 || nTag == thr.m_lockMessage.tag))
             {
                 return true;
             }
@@ -1479,516 +3145,796 @@ namespace thread
         }
 
         /**
-         * @brief Report how much waiting threads for a given reference pointer and tag value are there
+         * @brief Safely notify all LookForWaitings from a specific reference pointer along with a message without triggering context change
          *
          * @tparam T        Type of the reference pointer
-         * @param refVar    The reference pointer used a a notifier
+         * @param refVar    The reference pointer used as a notifier
          * @param nTag      The size_t tag that will give meaning to the notification
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
          *
-         * @return true
-         *
-         * @note This is a powerful tool since it create layers of waiting within the same reference pointer
+         * @return true     if at least one got notified, otherwise false.
          */
-        template<typename T> size_t HasWaitings(T& refVar, size_t nTag, aSubTypes asubType = aSubTypes::wait)
+        template<typename T> size_t SafeNotifyLookWaitings(T& refVar, size_t nTag)
         {
-            size_t nCounter = 0;
-
-            for (auto& thr : *this)
-            {
-                if (IsNotificationEligible (thr, refVar, nTag, asubType))
-                {
-                    nCounter++;
-                }
-            }
+            size_t message=0;
 
-            return nCounter;
+            return SafeNotifier(message, refVar, nTag, aSubTypes::look, NotifyType::all);
         }
 
         /**
-         * @brief Blocks/Waits a notification along with a message and tag from a specific reference pointer
+         * @brief Safely notify all Waits from a specific reference pointer along with a message without triggering context change
          *
          * @tparam T        Type of the reference pointer
-         * @param nMessage  the size_t message to be received
-         * @param refVar    the reference pointer used as a notifier
-         * @param nTag      the size_t tag that will give meaning to the the message
-         * @param waitFor   default==0 (indefinitely), How log to wait for a notification based on atomicx_time
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
-         * @return true if it was successfully received.
-         * 
-         * @note if tag is set to zero Waits will return false on call.
+         * @param nMessage  The size_t message to be sent
+         * @param refVar    The reference pointer used as a notifier
+         * @param nTag      The size_t tag that will give meaning to the notification
+         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
+         *                  refVar waiting thread will be notified.
+         * @param pPayload  If not nullptr, nMessage bytes copied to the payload of each notified thread
+         *
+         * @return true     if at least one got notified, otherwise false.
          */
-        template<typename T> bool Wait(size_t& nMessage, T& refVar, size_t nTag, atomicx_time waitFor=0, aSubTypes asubType = aSubTypes::wait)
+        template<typename T> size_t SafeNotifier(size_t& nMessage, T& refVar, size_t nTag, aSubTypes subType, NotifyType notifyAll=NotifyType::one, const void* pPayload=nullptr)
         {
-            if (nTag == 0 ) return false; 
+            size_t nRet = 0;
+            atomicx* pThr = GetWaitQueue (&refVar);
 
-            SafeNotifyLookWaitings(refVar, nTag);
+#if ATOMICX_PAYLOAD_SIZE == 0
+            (void) pPayload;
+#endif
 
-            SetWaitParammeters (refVar, nTag, asubType);
+            // Waiters are kept in arrival order
+            while (pThr != nullptr)
+            {
+                atomicx* pNext = pThr->m_pWaitNext;
 
-            m_lockMessage.tag = nTag;
+                if (IsNotificationEligible (*pThr, refVar, nTag, subType))
+                {
+                    if (notifyAll == NotifyType::one)
+                    {
+                        // Wake the highest priority waiter, the oldest one among equals
+                        for (atomicx* pCandidate = pNext; pCandidate != nullptr; pCandidate = pCandidate->m_pWaitNext)
+                        {
+                            if (pCandidate->m_nPriority > pThr->m_nPriority && IsNotificationEligible (*pCandidate, refVar, nTag, subType))
+                            {
+                                pThr = pCandidate;
+                            }
+                        }
+
+#if ATOMICX_PAYLOAD_SIZE
+                        if (pPayload != nullptr)
+                        {
+                            memcpy ((void*) pThr->m_aPayload, pPayload, nMessage);
+                            pThr->m_flags.payloadReceived = true;
+                        }
+#endif
+                        pThr->NotifyThisThread (nMessage, nTag);
+
+                        return 1;
+                    }
 
-            Yield(waitFor);
+#if ATOMICX_PAYLOAD_SIZE
+                    if (pPayload != nullptr)
+                    {
+                        memcpy ((void*) pThr->m_aPayload, pPayload, nMessage);
+                        pThr->m_flags.payloadReceived = true;
+                    }
+#endif
+                    pThr->NotifyThisThread (nMessage, nTag);
 
-            bool bRet = false;
+                    nRet++;
+                }
 
-            if (m_aSubStatus != aSubTypes::timeout)
-            {
-                nMessage = m_lockMessage.message;
-                bRet = true;
+                pThr = pNext;
             }
 
-            m_lockMessage = {0,0};
-
-            m_aSubStatus = aSubTypes::ok;
-
-            return bRet;
+            return nRet;
         }
 
         /**
-         * @brief Blocks/Waits a notification along with a tag from a specific reference pointer
-         *
-         * @tparam T        Type of the reference pointer
-         * @param refVar    the reference pointer used as a notifier
-         * @param nTag      the size_t tag that will give meaning to the the message, if nTag == 0 means wait all refVar regardless
-         * @param waitFor   default==0 (indefinitely), How log to wait for a notification based on atomicx_time
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
+         * @brief Gather the segments into the buffers of the threads waiting in ReceiveBulk on
+         *        pLockId, highest priority first (the oldest among equals), and notify them
+         *
+         * @param pDeliveries   Results, the first nServed are the receivers already served
+         * @param nServed       Receivers already served, skipped if they wait again
+         * @param nReceivers    Max receivers to serve, size of pDeliveries
+         *
+         * @return size_t   Receivers served so far, nServed plus the new ones
+         */
+        static size_t TransferTo (const void* pLockId, const Segment* pSegments, size_t nSegments, Delivery* pDeliveries, size_t nServed, size_t nReceivers);
+
+        /**
+         * @brief Check if a buffer is on the stack of this running thread, where the stack copy
+         *        backend can not reach it while the thread is parked
          *
-         * @return true if it was successfully received.
+         * @return true with the stack copy backend and pData on the thread stack, otherwise false
          */
-        template<typename T> bool Wait(T& refVar, size_t nTag, atomicx_time waitFor=0, aSubTypes asubType = aSubTypes::wait)
-        {
-            size_t nMessage = 0;
+        bool IsOnThreadStack (const void* pData);
 
-            return Wait (nMessage, refVar, nTag, waitFor, asubType);
-        }
-        
         /**
-         * @brief Blocks/Waits for any notification from a specific reference pointer and reports message and tag
+         * @brief Set the Default Parameters for constructors
          *
-         * @tparam T        Type of the reference pointer
-         * @param nMessage  return ref size_t message received
-         * @param refVar    the reference pointer used as a notifier
-         * @param nTag      return ref size_t tag that will give meaning to the the message
-         * @param waitFor   default==0 (indefinitely), How log to wait for a notification based on atomicx_time
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
-         * @return true if it was successfully received.
          */
-        template<typename T> bool WaitAny(size_t& nMessage, T& refVar, size_t& nTag, atomicx_time waitFor=0, aSubTypes asubType = aSubTypes::wait)
+        void SetDefaultInitializations ();
+
+        /**
+         * @brief Configure the Wait parameters for the current thread.
+         * 
+         * @tparam T 
+         * @param refVar 
+         * @param nTag 
+         * @param asubType 
+         */
+        template<typename T> void SetWaitParammeters (T& refVar, size_t nTag, aSubTypes asubType = aSubTypes::wait)
         {
-            nTag = 0;
+            m_pLockId = (uint8_t*)&refVar;
+            m_aStatus = aTypes::wait;
+            m_aSubStatus = asubType;
 
-            SafeNotifyLookWaitings(refVar, nTag);
+            m_lockMessage.tag = nTag;
+            m_lockMessage.message = 0;
 
-            SetWaitParammeters (refVar, nTag, asubType);
+#if ATOMICX_PAYLOAD_SIZE
+            m_flags.payloadReceived = false;
+#endif
+        }
 
-            Yield(waitFor);
+        /**
+         * @brief Double the thread registry from the heap
+         *
+         * @return true if there are free slots now, false with ATOMICX_NO_HEAP or no memory
+         */
+        static bool GrowSlots();
 
-            bool bRet = false;
+        /**
+         * @brief Add the current thread to the global thread list
+         */
+        void AddThisThread();
 
-            if (m_aSubStatus != aSubTypes::timeout)
-            {
-                nMessage = m_lockMessage.message;
-                nTag = m_lockMessage.tag;
-                
-                bRet = true;
-            }
+        /**
+         * @brief Remove the current thread to the global thread list
+         */
+        void RemoveThisThread();
 
-            m_lockMessage = {0,0};
+        /**
+         * @brief Internally used to unload thread parameters and detach from the static list
+         */
+        void DestroyThread();
 
-            m_aSubStatus = aSubTypes::ok;
+        /**
+         * @brief Detach from the static list and the scheduler, the stack buffer is kept (threadPool)
+         */
+        void RecycleThread();
 
-            return bRet;
-        }
+        /**
+         * @brief Attach a recycled thread again, to be started as a new one (threadPool)
+         */
+        void RearmThread();
 
+#if ATOMICX_DEDICATED_STACK
         /**
-         * @brief Blocks/Waits for any notification from a specific reference pointer and also return the tag
-         *
-         * @tparam T        Type of the reference pointer
-         * @param refVar    the reference pointer used as a notifier
-         * @param nTag      return ref size_t tag that will give meaning to the the message
-         * @param waitFor   default==0 (indefinitely), How log to wait for a notification based on atomicx_time
-         * @param asubType  Type of the notification, only use it if you know what you are doing, it creates a different
-         *                  type of wait/notify, deafault == aSubType::wait
+         * @brief Build the initial frame of a thread about to (re)start on its own stack,
+         *        allocating auto stacks on first use
          *
-         * @return true if it was successfully received.
+         * @return true if the stack is ready, false if it could not be allocated
          */
-        template<typename T> bool WaitAny(T& refVar, size_t& nTag, atomicx_time waitFor=0, aSubTypes asubType = aSubTypes::wait)
-        {
-            size_t nMessage = 0;
-            
-            return WaitAny (nMessage, refVar, nTag, waitFor, asubType);
-        }
+        bool PrepareStack();
 
         /**
-         * ------------------------------
-         * MESSAGE BROADCAST IMPLEMENTATION
-         * Public part for the implementation
-         * ------------------------------
+         * @brief First function executed on a dedicated stack, runs the current thread
+         *        and hands the CPU back to the kernel once run() returns
+         */
+        static void StackEntry();
+
+        /**
+         * @brief Free a stack released while the CPU was still running on it
          */
+        static void ReleaseStack();
+#endif
 
+#if ATOMICX_STACK_PROFILE
         /**
-         * @brief Broadcast a message to all threads
+         * @brief Account the stack used at a Yield
          *
-         * @param messageReference Works as the signaling
-         * @param message   Message structure with the message
-         *                  message is the payload
-         *                  tag is the meaning
+         * @param pSite     Return address of the Yield call
+         */
+        void ProfileStack(void* pSite);
+#endif
+
+#if ATOMICX_STACK_COMPRESS
+        /**
+         * @brief Compress the saved stack with ATOMICX_STACK_CODEC and release the save buffer
          *
-         * @return size_t
+         * @return true if it was compressed, false if it does not shrink enough (or no memory)
          */
-        size_t BroadcastMessage (const size_t messageReference, const Message message);
+        bool CompressStack();
 
         /**
-         *   SEND AND RECEIVE DATA USING DATA PIPES 
-         *   to 1 to many
+         * @brief Bring back the save buffer from the compressed stack
+         *
+         * @return true if successful, otherwise false
          */
-        
-        enum class TransferState : uint8_t
-        {
-            ready=10,
-            start=11,
-            transfering=12,
-            end=13
-        };
+        bool DecompressStack();
 
-        typedef size_t tranfer_t;
-        
-        template<typename T> uint16_t Send (T& refVar, uint8_t* pData, uint16_t nDataSize, Timeout timeout)
-        {
-            size_t nReceivers = 0;
+        /**
+         * @brief Compress the stacks of the threads parked for ATOMICX_STACK_COMPRESS_AFTER ticks,
+         *        only the due ones at the head of the parked list are visited
+         *
+         * @param nNow  Current tick
+         */
+        static void CompressParkedStacks(atomicx_time nNow);
 
-            if (pData == nullptr || nDataSize == 0) return 0;
+        /**
+         * @brief Append the thread that just saved its stack to the parked list (compression candidates)
+         */
+        void AddThisThreadToParkedList();
 
-            // Starting
-            if ((nReceivers = SyncNotify (nDataSize, refVar, (size_t) TransferState::start, timeout.GetRemaining ())) == 0)
-            {
-                // There is no reader listening the same refVar
-                return 0;
-            }
+        /**
+         * @brief Take the thread out of the parked list, if it is there
+         */
+        void RemoveThisThreadFromParkedList();
+#endif
 
-            uint8_t nMessage [sizeof (tranfer_t)];
-            const uint8_t nPayloadSize = sizeof (tranfer_t)-1;
-            uint16_t nDataSent = 0;
-            
-            // Transfering
-            while (nDataSize && ! timeout.IsTimedout ())
-            {
-                 nMessage [0] = nDataSize < (nPayloadSize) ? nDataSize : nPayloadSize;
-                                             
-                if (! (memcpy ((void*) &nMessage[1], pData, nMessage [0]) != nullptr 
-                   && LookForWaitings(refVar, (size_t) TransferState::transfering, (size_t) nReceivers, timeout.GetRemaining ())
-                   && ! timeout.IsTimedout ()
-                   && SyncNotify (*((size_t*) nMessage), refVar, (size_t) TransferState::transfering, timeout.GetRemaining ())))
-                {
-                    return 0;
-                }
+        /**
+         * @brief CRC16 used to compose a multi uint32_t for Topic ID
+         *
+         * @param pData     Data bytes to be used on calculation
+         * @param nSize     The size of the Data bytes
+         * @param nCRC      The previous CRC calculated or a specific starter (salt)
+         *
+         * @return uint16_t the CRC calculated.
+         */
+        uint16_t crc16(const uint8_t* pData, size_t nSize, uint16_t nCRC);
 
-                nDataSize -= (size_t) nMessage [0];
-                pData += (size_t) nMessage [0];
-                nDataSent += (size_t) nMessage [0];
-            }
+        /**
+         * @brief The scheduler used by the kernel implementation
+         *
+         * @return true it at least one thread is not blocked, if all threads a blocked
+         *          a false is returned telling to the kernel  to stop Start with false.
+         */
+        static bool SelectNextThread(void);
 
-            // Finishing
-            if (! (! timeout.IsTimedout () && LookForWaitings(refVar, (size_t) TransferState::transfering, (size_t) nReceivers, timeout.GetRemaining ()) && ! timeout.IsTimedout ()
-                && SyncNotify (nDataSent, refVar, (size_t) TransferState::end, timeout.GetRemaining ())))
-            {
-                return 0;
-            }
+        /**
+         * @brief (Re)Insert the thread in the scheduler queue that matches its current status
+         *
+         * @note  start/now goes to the ready FIFO, sleep and timed wait to the timer heap,
+         *        stop and wait without timeout are not queued at all.
+         */
+        void EnqueueThisThread();
 
-            return nDataSent;
-        }
+        /**
+         * @brief Remove the thread from whatever scheduler queue it is in
+         */
+        void DequeueThisThread();
 
-        template<typename T> uint16_t Receive (T& refVar, uint8_t* pData, uint16_t nDataSize, Timeout timeout)
-        {
-            size_t nMessage = 0;
-            size_t nTag = 0;
-            TransferState state = TransferState::ready;
-        
-            uint8_t  nWriteLen = 0;
-            uint16_t nReceivedLen = 0;
+        /**
+         * @brief Remove the thread from its run or timer queue, keeping it in its wait queue
+         */
+        void RemoveThisThreadFromRunQueue();
 
-            if (pData == nullptr || nDataSize == 0) return 0;
+        /**
+         * @brief Append the thread to the wait queue of its m_pLockId
+         */
+        void AddThisThreadToWaitQueue();
 
-            while (! timeout.IsTimedout () && WaitAny (nMessage, refVar, nTag, timeout.GetRemaining ()))
-            {
-                //Wait to start
-                if (state  == TransferState::ready)
-                {
-                    if ((TransferState) nTag == TransferState::start)
-                    {
-                        state = TransferState::transfering;
-                    }
-                    else
-                    {
-                        continue;
-                    }
-                }
-                else if (state == TransferState::transfering && state == (TransferState) nTag && nReceivedLen < nDataSize) // transfering
-                {
-                    // Transfering
-                    uint8_t* nPayload = (uint8_t*) &nMessage;
-                    nWriteLen = (nReceivedLen + nPayload [0]) > nDataSize ? (nDataSize - nReceivedLen) : nPayload [0];
+        /**
+         * @brief Remove the thread from the wait queue of its m_pLockId
+         */
+        void RemoveThisThreadFromWaitQueue();
 
-                    if (memcpy (pData, &nPayload[1], nWriteLen) == nullptr)
-                    {
-                        return 0;
-                    }
+        /**
+         * @brief Get the oldest thread waiting on a reference pointer
+         *
+         * @param pLockId   The reference pointer
+         *
+         * @return atomicx* first waiting thread, follow m_pWaitNext for the others, otherwise nullptr
+         */
+        static atomicx* GetWaitQueue(const void* pLockId);
 
-                    pData += nPayload [0];
-                    nReceivedLen += nPayload [0];
-                }
-                else if (state == TransferState::transfering && (TransferState) nTag == TransferState::end)
-                {
-                    // Ending
-                    break;
-                }
-            }
-            
-            return timeout.IsTimedout () ? 0 : nReceivedLen;
-        }
+        /**
+         * @brief Wake up a waiting thread delivering a notification
+         *
+         * @param nMessage  The message to be delivered
+         * @param nTag      The notification tag
+         */
+        void NotifyThisThread(size_t nMessage, size_t nTag);
 
-    /**
-     *  PROTECTED METHODS, THOSE WILL BE ONLY ACCESSIBLE BY THE THREAD ITSELF
-     */
-    protected:
+        /**
+         * @brief Hand a start/now thread over to the scheduler policy as ready
+         *
+         * @param thr       Thread to be appended
+         */
+        static void PushReadyQueue(atomicx& thr);
 
         /**
-         * @brief The pure virtual function that runs the thread loop
+         * @brief Hand a due sleeper or timed wait over to the scheduler policy as expired
          *
-         * @note REQUIRED implementation and once it returns it will execute finish method
+         * @param thr       Thread to be appended
          */
-        virtual void run(void) noexcept = 0;
+        static void PushExpiredQueue(atomicx& thr);
 
         /**
-         * @brief Handles the StackOverflow of the current thread
+         * @brief Change the effective priority, handing the thread over to the policy again if it is runnable
          *
-         * @note REQUIRED
+         * @param nPriority     The new effective priority
          */
-        virtual void StackOverflowHandler(void) noexcept = 0;
+        void SetEffectivePriority(uint8_t nPriority);
 
         /**
-         * @brief Called right after run returns, can be used to self-destroy the object and other maintenance actions
+         * @brief Lend a lock waiter priority to this thread (lock holder) if higher than its own,
+         *        and on along the chain of holders this one is blocked by
          *
-         * @note if not implemented a default "empty" call is used instead
+         * @param nPriority     The waiter priority
          */
-        virtual void finish() noexcept;
+        void InheritPriority(uint8_t nPriority);
 
         /**
-         * ------------------------------
-         * MESSAGE BROADCAST IMPLEMENTATION
-         * ------------------------------
+         * @brief Drop a lent priority no waiter backs anymore, this thread back to the max of its
+         *        base priority and the threads still blocked by it, and so on along the chain
          */
+        void RecomputePriority();
 
-         /**
-         * @brief The default broadcast handler used to received the message
-         * 
-         * @param messageReference Works as the signaling
-         * @param message   Message structure with the message
-         *                  message is the payload
-         *                  tag is the meaning
+        /**
+         * @brief Record that this thread is about to wait for a lock held by pOwner and lend it its priority
+         *
+         * @param pOwner        The lock holder
          */
-        virtual void BroadcastHandler (const size_t& messageReference, const Message& message);
-        
+        void LockWaitStarted(atomicx* pOwner);
+
         /**
-         * @brief Enable or Disable async broadcast 
-         * 
-         * @param bBroadcastStatus   if true, the thread will receive broadcast otherwise no
+         * @brief Done waiting for a lock (acquired or timed out), the holder priority is recomputed
          */
-        void SetReceiveBroadcast (bool bBroadcastStatus);
+        void LockWaitEnded();
 
         /**
-         * @brief Set the Stack Increase Pace object
+         * @brief Account a mutex or binary semaphore acquired by this thread
          *
-         * @param nIncreasePace The new stack increase pace value
+         * @param lock      The lock link, kept in the held lock list
          */
-        void SetStackIncreasePace(size_t nIncreasePace);
+        void LockAcquired(heldLock& lock);
 
+        /**
+         * @brief Account a mutex or binary semaphore released, dropping what only its waiters lent
+         *
+         * @param lock      The lock link, taken out of the held lock list
+         */
+        void LockReleased(heldLock& lock);
 
         /**
-         *  SPECIAL PRIVATE SECTION FOR HELPER METHODS USED BY PROCTED METHODS
+         * @brief Highest priority among the threads blocked by this one on the locks it holds
+         *
+         * @param nPriority     Starting value, the base priority
+         *
+         * @return uint8_t  The priority this thread must run at
          */
-    private:
+        uint8_t GetInheritedPriority(uint8_t nPriority);
 
         /**
-         * @brief Report is the current thread, refVar, ntag and subType is eligible to receive a notification 
-         * 
-         * @tparam T        the object used as the reference pointer
-         * @param thr       The thread to be notified
-         * @param refVar    The reference pointer used as a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification
-         * @param subType   The subtype of the type::wait
-         * 
-         * @return false    if the current thread can not be notified with the given configuration, otherwise true
+         * @brief Append a thread to a scheduler FIFO
+         *
+         * @param pFirst    Reference to the FIFO head
+         * @param pLast     Reference to the FIFO tail
+         * @param thr       Thread to be appended
          */
-        template<typename T> bool IsNotificationEligible (atomicx& thr, T& refVar, size_t nTag, aSubTypes subType)
-        {
-            if (thr.m_aSubStatus == subType &&
-                thr.m_aStatus == aTypes::wait &&
-                thr.m_pLockId == (void*) &refVar &&
-                (nTag == 0 || thr.m_lockMessage.tag == 0 || nTag == thr.m_lockMessage.tag))
-            {
-                return true;
-            }
+        static void PushRunQueue(atomicx*& pFirst, atomicx*& pLast, atomicx& thr);
 
-            return false;
-        }
+        /**
+         * @brief Remove a thread from a scheduler FIFO
+         *
+         * @param pFirst    Reference to the FIFO head
+         * @param pLast     Reference to the FIFO tail
+         * @param thr       Thread to be removed
+         */
+        static void RemoveRunQueue(atomicx*& pFirst, atomicx*& pLast, atomicx& thr);
 
         /**
-         * @brief Safely notify all LookForWaitings from a specific reference pointer along with a message without triggering context change
+         * @brief Meld two pairing heaps ordered by a time member (m_nTargetTime, m_nDeadline or m_nVirtualRuntime)
          *
-         * @tparam T        Type of the reference pointer
-         * @param refVar    The reference pointer used as a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification
+         * @param pHeapA    Root of the first heap (can be nullptr)
+         * @param pHeapB    Root of the second heap (can be nullptr)
+         * @param pKey      The member the heap is ordered by
          *
-         * @return true     if at least one got notified, otherwise false.
+         * @return atomicx* the new root
          */
-        template<typename T> size_t SafeNotifyLookWaitings(T& refVar, size_t nTag)
-        {
-            size_t message=0;
-
-            return SafeNotifier(message, refVar, nTag, aSubTypes::look, NotifyType::all);
-        }
+        static atomicx* HeapMeld(atomicx* pHeapA, atomicx* pHeapB, atomicx_time atomicx::* pKey);
 
         /**
-         * @brief Safely notify all Waits from a specific reference pointer along with a message without triggering context change
+         * @brief Two pass pairing of a sibling list into a single heap
          *
-         * @tparam T        Type of the reference pointer
-         * @param nMessage  The size_t message to be sent
-         * @param refVar    The reference pointer used as a notifier
-         * @param nTag      The size_t tag that will give meaning to the notification
-         * @param notifyAll default = false, and only the fist available refVar Waiting thread will be notified, if true all available
-         *                  refVar waiting thread will be notified.
+         * @param pFirst    First sibling
+         * @param pKey      The member the heap is ordered by
          *
-         * @return true     if at least one got notified, otherwise false.
+         * @return atomicx* the new root
          */
-        template<typename T> size_t SafeNotifier(size_t& nMessage, T& refVar, size_t nTag, aSubTypes subType, NotifyType notifyAll=NotifyType::one)
-        {
-            size_t nRet = 0;
-
-            for (auto& thr : *this)
-            {
-                if (IsNotificationEligible (thr, refVar, nTag, subType))
-                {
-                    thr.m_aStatus = aTypes::now;
-                    thr.m_nTargetTime = 0;
-                    thr.m_pLockId = nullptr;
-
-                    thr.m_lockMessage.message = nMessage;
-                    thr.m_lockMessage.tag = nTag;
-
-                    nRet++;
-
-                    if (notifyAll == NotifyType::one)
-                    {
-                        break;
-                    }
-                }
-            }
-
-            return nRet;
-        }
+        static atomicx* HeapMergePairs(atomicx* pFirst, atomicx_time atomicx::* pKey);
 
         /**
-         * @brief Set the Default Parameters for constructors
+         * @brief Remove and return the earliest thread of a heap
          *
+         * @param pRoot     Reference to the heap root
+         * @param pKey      The member the heap is ordered by
+         *
+         * @return atomicx* the removed thread or nullptr if the heap is empty
          */
-        void SetDefaultInitializations ();
+        static atomicx* HeapPop(atomicx*& pRoot, atomicx_time atomicx::* pKey);
 
         /**
-         * @brief Configure the Wait parameters for the current thread.
-         * 
-         * @tparam T 
-         * @param refVar 
-         * @param nTag 
-         * @param asubType 
+         * @brief Remove an arbitrary thread from a heap
+         *
+         * @param pRoot     Reference to the heap root
+         * @param thr       The thread to be removed
+         * @param pKey      The member the heap is ordered by
          */
-        template<typename T> void SetWaitParammeters (T& refVar, size_t nTag, aSubTypes asubType = aSubTypes::wait)
-        {
-            m_pLockId = (uint8_t*)&refVar;
-            m_aStatus = aTypes::wait;
-            m_aSubStatus = asubType;
-
-            m_lockMessage.tag = nTag;
-            m_lockMessage.message = 0;
-        }
+        static void HeapRemove(atomicx*& pRoot, atomicx& thr, atomicx_time atomicx::* pKey);
 
         /**
-         * @brief Add the current thread to the global thread list
+         * @brief Arm the timer of a sleeping or timed wait thread for m_nTargetTime
+         *
+         * @param thr       The thread to be armed
          */
-        void AddThisThread();
+        static void TimerArm(atomicx& thr);
 
         /**
-         * @brief Remove the current thread to the global thread list
+         * @brief Cancel an armed timer
+         *
+         * @param thr       The thread to be cancelled
          */
-        void RemoveThisThread();
+        static void TimerCancel(atomicx& thr);
 
         /**
-         * @brief Internally used to unload thread parameters and detach from the static list
+         * @brief Move all timers due by nNow to the expired queue
+         *
+         * @param nNow      Current tick
          */
-        void DestroyThread();
+        static void TimerExpire(atomicx_time nNow);
 
         /**
-         * @brief CRC16 used to compose a multi uint32_t for Topic ID
+         * @brief Get when the next timer is due
          *
-         * @param pData     Data bytes to be used on calculation
-         * @param nSize     The size of the Data bytes
-         * @param nCRC      The previous CRC calculated or a specific starter (salt)
+         * @param nNext     Return the tick of the next timer event
          *
-         * @return uint16_t the CRC calculated.
+         * @return true if there is at least one armed timer, otherwise false
+         *
+         * @note  With the timing wheel nNext can be a lower bound, the tick where
+         *        the next slot will be cascaded
          */
-        uint16_t crc16(const uint8_t* pData, size_t nSize, uint16_t nCRC);
+        static bool TimerNext(atomicx_time& nNext);
 
+#if ATOMICX_TIMER_WHEEL
         /**
-         * @brief The scheduler used by the kernel implementation
+         * @brief Move the timing wheel time forward, cascading upper level slots when
+         *        the next tick starts a new block
          *
-         * @return true it at least one thread is not blocked, if all threads a blocked
-         *          a false is returned telling to the kernel  to stop Start with false.
+         * @param nTo       The new wheel time, all timers up to it were already expired
          */
-        static bool SelectNextThread(void);
+        static void WheelAdvance(atomicx_time nTo);
+#endif
 
         /**
          * Thread related controll variable
+         *
+         * Hot first: what the run queues, heaps, timers and wait queues read for every
+         * candidate is packed right after the vptr, in two 64 byte lines on 64 bit targets
+         * (one for the scheduler, one for the wait queues). The context, stack and statistic
+         * fields are only touched by the running thread or on a switch and come after.
+         */
+
+        /*
+         * Scheduler queue links, since a thread is only in one queue at a time
+         * the same links are used by the FIFOs and by the heaps (sibling/parent),
+         * ready and expired threads are owned by the scheduler policy
+         */
+        enum class aQueues : uint8_t
+        {
+            none=0,
+            ready,
+            expired,
+            timer
+        };
+
+        atomicx* m_pRunNext = nullptr;
+        atomicx* m_pRunPrev = nullptr;
+        atomicx* m_pHeapChild = nullptr;
+
+        uint8_t* m_pLockId=nullptr;
+
+        atomicx_time m_nTargetTime=0;
+        atomicx_time m_nDeadline=0;
+#if ATOMICX_SCHED_FAIR
+        atomicx_time m_nVirtualRuntime=0;
+#endif
+
+        aTypes  m_aStatus = aTypes::start;
+        aSubTypes m_aSubStatus = aSubTypes::ok;
+        aQueues m_aQueue = aQueues::none;
+
+        uint8_t m_nPriority=0;
+        uint8_t m_nBasePriority=0;
+
+        struct
+        {
+            bool KernelIsRunning : 1;
+#if ATOMICX_AUTO_STACK
+            bool autoStack : 1;
+#endif
+#if ATOMICX_DYNAMIC_NICE
+            bool dynamicNice : 1;
+#endif
+#if ATOMICX_BROADCAST
+            bool broadcast : 1;
+#endif
+            bool attached :1;
+            bool waitQueued : 1;
+            bool pooled : 1;
+#if ATOMICX_DEDICATED_STACK && ATOMICX_STACK_PROFILE
+            bool stackPainted : 1;
+#endif
+#if ATOMICX_PAYLOAD_SIZE
+            bool payloadReceived : 1;
+#endif
+        } m_flags = {};
+
+#if ATOMICX_TIMER_WHEEL
+        uint16_t m_nTimerSlot = 0;
+#endif
+
+        atomicx_time m_nice=0;
+
+        /*
+         * Per reference pointer wait queue (FIFO), the first waiter of each reference pointer
+         * is the channel, it also holds the FIFO tail and the next channel of the hash bucket
          */
+        atomicx* m_pWaitNext = nullptr;
+        atomicx* m_pWaitPrev = nullptr;
+        atomicx* m_pWaitLast = nullptr;
+        atomicx* m_pWaitChannel = nullptr;
+
+        Message m_lockMessage = {0,0};
 
         atomicx* m_paNext = nullptr;
         atomicx* m_paPrev = nullptr;
 
+        // Cold
         jmp_buf m_context;
 
+#if ATOMICX_DEDICATED_STACK
+        void* m_pStackPointer = nullptr;
+#endif
+
         size_t m_stackSize=0;
         size_t m_stacUsedkSize=0;
+#if ATOMICX_AUTO_STACK
         size_t m_stackIncreasePace=1;
+#endif
 
-        Message m_lockMessage = {0,0};
+#if ATOMICX_STACK_POOL
+        uint16_t m_nLowStackSwitches=0;
+#endif
 
-        atomicx_time m_nTargetTime=0;
-        atomicx_time m_nice=0;
+#if ATOMICX_STACK_INCREMENTAL
+        // Bytes (from the buffer end) still holding the last save
+        size_t m_nSavedSize=0;
+#endif
+
+#if ATOMICX_STACK_PROFILE
+        // Stack use histogram, bucket n counts switches using less than 128 << n bytes, the last one the rest
+        static const uint8_t ms_nStackHistogram = 12;
+
+        size_t m_nMaxUsedStack=0;
+        void* m_pMaxUsedSite=nullptr;
+        uint32_t m_aStackHistogram[ms_nStackHistogram]{};
+#endif
+
+#if ATOMICX_STACK_COMPRESS
+        // Saved stack of a long parked thread, m_stack is released meanwhile
+        uint8_t* m_pCompressed=nullptr;
+        size_t m_nCompressedSize=0;
+
+        // Parked list, oldest park first
+        atomicx* m_pParkedNext=nullptr;
+        atomicx* m_pParkedPrev=nullptr;
+#endif
+
+#if ATOMICX_TIMING_STATS
         atomicx_time m_LastUserExecTime=0;
         atomicx_time m_lastResumeUserTime=0;
+#endif
 
-        aTypes  m_aStatus = aTypes::start;
-        aSubTypes m_aSubStatus = aSubTypes::ok;
+        // Mutexes and binary semaphores held, the waiters lending their priority are on their wait queues
+        heldLock* m_pHeldLocks=nullptr;
+
+        // Holder of the lock this thread is waiting for, the priority inheritance chain
+        atomicx* m_pBlockedBy=nullptr;
+
+        // Thread registry slot, 0xffff if it got none
+        uint16_t m_nSlot=0xffff;
+
+        atomicx_time m_nPeriod=0;
+        atomicx_time m_nRelativeDeadline=0;
+        atomicx_time m_nRelease=0;
+        atomicx_time m_nMaxLateness=0;
+        atomicx_time m_nTotalLateness=0;
+        size_t m_nJobs=0;
+        size_t m_nDeadlineMisses=0;
+
+#if ATOMICX_SCHED_FAIR
+        size_t m_nShare=ATOMICX_FAIR_SHARE;
+#endif
 
         volatile uint8_t* m_stack;
         volatile uint8_t* m_pStaskStart=nullptr;
         volatile uint8_t* m_pStaskEnd=nullptr;
 
-        uint8_t* m_pLockId=nullptr;
+#if ATOMICX_PAYLOAD_SIZE
+        // Written by the notifier, read by WaitPayload once the thread resumes
+        uint8_t m_aPayload[ATOMICX_PAYLOAD_SIZE];
+#endif
+    };
 
-        struct
+    /**
+     * --------------------------------
+     * SCHEDULER POLICIES
+     * --------------------------------
+     *
+     * A policy owns the runnable threads and tells the kernel which one runs next. It is chosen at
+     * compile time through ATOMICX_SCHED_POLICY and only has static methods, so there is no virtual
+     * call on the context switch path. A policy derives from policy::base, which exposes the intrusive
+     * FIFO/heap links of the threads, and implements:
+     *
+     *   static void Ready(atomicx& thr);                         start/now thread became runnable
+     *   static void Expired(atomicx& thr);                       sleep or timed wait is due
+     *   static void Remove(atomicx& thr);                        thread leaves the policy (selected, stopped, notified...)
+     *   static atomicx* Select();                                thread to run next, nullptr if none, not removed
+     *   static void Sleep(atomicx& thr, atomicx_time& nSleep);   the running thread is giving the CPU up with nSleep
+     */
+    namespace policy
+    {
+        struct base
         {
-            bool KernelIsRunning : 1;
-            bool autoStack : 1;
-            bool dynamicNice : 1;
-            bool broadcast : 1;
-            bool attached :1;
-        } m_flags = {0, 0,0,0,0};
-    };
+        protected:
+            static void PushFifo(atomicx*& pFirst, atomicx*& pLast, atomicx& thr)
+            {
+                atomicx::PushRunQueue (pFirst, pLast, thr);
+            }
+
+            static void RemoveFifo(atomicx*& pFirst, atomicx*& pLast, atomicx& thr)
+            {
+                atomicx::RemoveRunQueue (pFirst, pLast, thr);
+            }
+
+            static void PushHeap(atomicx*& pRoot, atomicx& thr, atomicx_time atomicx::* pKey)
+            {
+                thr.m_pRunNext = thr.m_pRunPrev = thr.m_pHeapChild = nullptr;
+                pRoot = atomicx::HeapMeld (pRoot, &thr, pKey);
+            }
+
+            static void RemoveHeap(atomicx*& pRoot, atomicx& thr, atomicx_time atomicx::* pKey)
+            {
+                atomicx::HeapRemove (pRoot, thr, pKey);
+            }
+
+            static atomicx_time atomicx::* DeadlineKey()
+            {
+                return &atomicx::m_nDeadline;
+            }
+
+#if ATOMICX_SCHED_FAIR
+            static atomicx_time atomicx::* VirtualRuntimeKey()
+            {
+                return &atomicx::m_nVirtualRuntime;
+            }
+
+            static atomicx_time& VirtualRuntime(atomicx& thr)
+            {
+                return thr.m_nVirtualRuntime;
+            }
+#endif
+
+            static bool IsExpired(const atomicx& thr)
+            {
+                return thr.m_aQueue == atomicx::aQueues::expired;
+            }
+        };
+
+        /**
+         * @brief Single ready FIFO before a single expired FIFO, priorities are ignored
+         */
+        struct roundRobin : base
+        {
+            static void Ready(atomicx& thr);
+            static void Expired(atomicx& thr);
+            static void Remove(atomicx& thr);
+            static atomicx* Select();
+            static void Sleep(atomicx& thr, atomicx_time& nSleep);
+
+        private:
+            static atomicx* ms_pReadyFirst;
+            static atomicx* ms_pReadyLast;
+            static atomicx* ms_pExpiredFirst;
+            static atomicx* ms_pExpiredLast;
+        };
+
+        /**
+         * @brief Ready and expired FIFOs per priority, the highest priority with a runnable
+         *        thread goes first (default policy)
+         */
+        struct priority : base
+        {
+            static void Ready(atomicx& thr);
+            static void Expired(atomicx& thr);
+            static void Remove(atomicx& thr);
+            static atomicx* Select();
+            static void Sleep(atomicx& thr, atomicx_time& nSleep);
+
+        private:
+            static atomicx* ms_paReadyFirst[ATOMICX_PRIORITIES];
+            static atomicx* ms_paReadyLast[ATOMICX_PRIORITIES];
+            static atomicx* ms_paExpiredFirst[ATOMICX_PRIORITIES];
+            static atomicx* ms_paExpiredLast[ATOMICX_PRIORITIES];
+            static uint32_t ms_readyMap;
+            static uint32_t ms_expiredMap;
+        };
+
+#if ATOMICX_SCHED_FAIR
+        /**
+         * @brief Least virtual runtime first, runnable threads in a heap keyed by it
+         */
+        struct fairShare : base
+        {
+            static void Ready(atomicx& thr);
+            static void Expired(atomicx& thr);
+            static void Remove(atomicx& thr);
+            static atomicx* Select();
+            static void Sleep(atomicx& thr, atomicx_time& nSleep);
+
+        private:
+            static atomicx* ms_pFairShare;
+            static atomicx_time ms_nMinVirtualRuntime;
+        };
+#endif
+
+        /**
+         * @brief Earliest Deadline First for periodic threads, the others are left to a background policy
+         *
+         * @tparam background   The policy used for non periodic threads
+         */
+        template <typename background> struct deadline : base
+        {
+            static void Ready(atomicx& thr);
+            static void Expired(atomicx& thr);
+            static void Remove(atomicx& thr);
+            static atomicx* Select();
+            static void Sleep(atomicx& thr, atomicx_time& nSleep);
+
+        private:
+            static atomicx* ms_pDeadlines;
+        };
+    }
+
+    /**
+     * --------------------------------
+     * STACK CODECS
+     * --------------------------------
+     *
+     * Compress the saved stacks of parked threads (ATOMICX_STACK_COMPRESS), the codec is chosen at
+     * compile time through ATOMICX_STACK_CODEC and implements:
+     *
+     *   static size_t Compress(const uint8_t* pIn, size_t nIn, uint8_t* pOut, size_t nOutMax);
+     *          bytes written to pOut, 0 if it does not fit in nOutMax
+     *   static size_t Decompress(const uint8_t* pIn, size_t nIn, uint8_t* pOut, size_t nOut);
+     *          bytes written to pOut, anything but nOut is an error
+     */
+    namespace codec
+    {
+        /**
+         * @brief Byte oriented LZ77, literal runs and matches of 4 to 131 bytes up to 64K back,
+         *        zero filled and repeated frames shrink a lot, uses a 2 KB static hash table
+         */
+        struct lz
+        {
+            static size_t Compress(const uint8_t* pIn, size_t nIn, uint8_t* pOut, size_t nOutMax);
+            static size_t Decompress(const uint8_t* pIn, size_t nIn, uint8_t* pOut, size_t nOut);
+        };
+    }
 }
 
 #endif /* atomicx_hpp */
@@ -159,8 +159,8 @@ protected:
                 {
                     logger << "Starting up a new remote terminal." << std::endl;
 
-                    // Starting a new thread
-                    new TelnetTerminal (10, m_tcpServer);
+                    // Starting a new thread, a recycled one once the pool has warmed up
+                    TelnetTerminal::pool.Spawn (10)->Accept (m_tcpServer);
                 }
             }            
         } while (Yield ());
@@ -41,8 +41,23 @@
 
 #include "TelnetTerminal.hpp"
 
-TelnetTerminal::TelnetTerminal(atomicx_time nNice, WiFiServer& server) : TerminalInterface(nNice, (Stream&) m_telnetClient), m_telnetClient (server.available ()), pszName{}
+atomicx::threadPool<TelnetTerminal> TelnetTerminal::pool;
+
+TelnetTerminal::TelnetTerminal(atomicx_time nNice) : TerminalInterface(nNice, (Stream&) m_telnetClient), m_telnetClient (), pszName{}
 {
+}
+
+void TelnetTerminal::Rearm (atomicx_time nNice)
+{
+    SetNice (nNice);
+
+    pszName[0] = '\0';
+}
+
+void TelnetTerminal::Accept (WiFiServer& server)
+{
+    m_telnetClient = server.available ();
+
     std::stringstream sstrName;
     sstrName << m_telnetClient.remoteIP().toString ().c_str () << ":" << m_telnetClient.remotePort();
 
@@ -72,7 +87,7 @@ void TelnetTerminal::finish() noexcept
 
     logger << LOG::INFO << "Telnet terminal " << m_telnetClient.remoteIP().toString ().c_str () << ", disconnecting." << std::endl;
     
-    delete this;
+    pool.Recycle (*this);
 }
 
 bool TelnetTerminal::IsConnected ()
@@ -50,7 +50,20 @@ class TelnetTerminal : public TerminalInterface
 {
 public:
     TelnetTerminal() = delete;
-    TelnetTerminal (atomicx_time nNice, WiFiServer& server);
+    TelnetTerminal (atomicx_time nNice);
+
+    /**
+     * @brief Constructor arguments again for a recycled terminal, called by pool.Spawn()
+     */
+    void Rearm (atomicx_time nNice);
+
+    /**
+     * @brief Take the pending client of the server, call it right after pool.Spawn()
+     */
+    void Accept (WiFiServer& server);
+
+    // Finished terminals go back here, with their stacks, for the next client
+    static atomicx::threadPool<TelnetTerminal> pool;
 
 protected:
     void PrintMOTD() final;
@@ -12,7 +12,8 @@
 #include "watchdog.hpp"
 
 Watchdog::Item::Item (atomicx& thread, atomicx_time allowedTime, bool isCritical):
-    nThreadId (&thread), 
+    nThreadId (thread.GetID ()), 
+    handle (thread.GetHandle ()),
     nextAllarm (),
     allowedTime (allowedTime), 
     isCritical (isCritical), 
@@ -124,7 +125,7 @@ void Watchdog::run()
                     }
                     else
                     {
-                        atomicx* pthread = thread::atomicx::GetThread (wtdItem().nThreadId);
+                        atomicx* pthread = thread::atomicx::GetThread (wtdItem().handle);
 
                         if (pthread && pthread->IsStopped () == false)
                         {
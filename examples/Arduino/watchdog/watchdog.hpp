@@ -37,6 +37,7 @@ public:
         friend class Watchdog;
 
         size_t nThreadId = 0;
+        atomicx::Handle handle;
         atomicx::Timeout nextAllarm;
         atomicx_time allowedTime=0;
 
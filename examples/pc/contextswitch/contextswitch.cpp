@@ -0,0 +1,140 @@
+//
+//  contextswitch.cpp
+//  atomicx
+//
+//  Measures the cost of a context switch by the stack depth at the
+//  Yield point, build it with and without -DATOMICX_DEDICATED_STACK=1
+//  to compare the stack copy and the dedicated stack backends.
+//
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <cstdint>
+#include <iostream>
+
+#include "atomicx.hpp"
+
+using namespace thread;
+
+atomicx_time Atomicx_GetTick (void)
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+
+    return (atomicx_time)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+}
+
+void Atomicx_SleepTick(atomicx_time nSleep)
+{
+    usleep ((useconds_t)nSleep * 1000);
+}
+
+static uint64_t GetNanoseconds ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static const size_t nSwitches = 200000;
+static const size_t aDepths[] = {0, 1024, 4096, 16384};
+
+/*
+ * Two workers yield to each other the same number of times with
+ * the same stack depth, the reporter measures and prints
+ */
+class Worker : public atomicx
+{
+public:
+    Worker(bool bReporter) : atomicx(stack), m_bReporter(bReporter)
+    {
+        SetNice (0);
+    }
+
+    void run() noexcept override
+    {
+        for (size_t nDepth : aDepths)
+        {
+            Deep (nDepth, nDepth);
+        }
+
+        Stop ();
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return m_bReporter ? "Reporter" : "Worker";
+    }
+
+private:
+
+    void Deep (size_t nDepth, size_t nRemaining)
+    {
+        volatile uint8_t pad[256];
+
+        pad[0] = (uint8_t) nRemaining;
+
+        if (nRemaining > sizeof (pad))
+        {
+            Deep (nDepth, nRemaining - sizeof (pad));
+        }
+        else
+        {
+            Switch (nDepth);
+        }
+
+        (void) pad[0];
+    }
+
+    void Switch (size_t nDepth)
+    {
+#if ATOMICX_STACK_INCREMENTAL
+        size_t nCopied = GetStackBytesCopied ();
+        size_t nSkipped = GetStackBytesSkipped ();
+#endif
+        uint64_t nStart = GetNanoseconds ();
+
+        for (size_t nCount = 0; nCount < nSwitches; nCount++)
+        {
+            Yield (0);
+        }
+
+        if (m_bReporter)
+        {
+            uint64_t nElapsed = GetNanoseconds () - nStart;
+
+            std::cout << "Depth: " << nDepth << " bytes, used stack: " << GetUsedStackSize ()
+                      << " bytes, " << (nElapsed / (nSwitches * 2)) << " ns per switch" << std::endl;
+
+#if ATOMICX_STACK_INCREMENTAL
+            std::cout << "    stack bytes written: " << (GetStackBytesCopied () - nCopied) / (nSwitches * 2)
+                      << ", unchanged: " << (GetStackBytesSkipped () - nSkipped) / (nSwitches * 2) << " per switch" << std::endl;
+#endif
+        }
+    }
+
+    bool m_bReporter;
+    uint8_t stack[65536]="";
+};
+
+int main()
+{
+#if ATOMICX_DEDICATED_STACK
+    std::cout << "Backend: dedicated stacks" << std::endl;
+#else
+    std::cout << "Backend: stack copy" << std::endl;
+#endif
+
+    Worker reporter(true);
+    Worker worker(false);
+
+    atomicx::Start();
+}
@@ -0,0 +1,178 @@
+//
+//  fanout.cpp
+//  atomicx
+//
+//  A telemetry broadcaster gathers a header and a sample block into one
+//  message with SendV and fans it out to three readers, one copy into
+//  each reader buffer. The slow reader misses frames, the fast ones do
+//  not wait for it, and the per reader results tell who got what.
+//
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "atomicx.hpp"
+
+using namespace thread;
+
+atomicx_time Atomicx_GetTick (void)
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+
+    return (atomicx_time)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+}
+
+void Atomicx_SleepTick(atomicx_time nSleep)
+{
+    usleep ((useconds_t)nSleep * 1000);
+}
+
+static uint64_t GetNanoseconds ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+struct Header
+{
+    uint32_t nFrame;
+    uint32_t nSamples;
+};
+
+static const size_t nSamples = 256;
+static const size_t nFrames = 200;
+static const size_t nReaders = 3;
+
+static uint32_t nTelemetry = 0;
+static uint32_t nPark = 0;
+static bool bDone = false;
+
+class Reader : public atomicx
+{
+public:
+    Reader(const char* pszName, size_t nBufferSize, atomicx_time nProcessing) :
+        atomicx(stack), m_pszName(pszName), m_nBufferSize(nBufferSize), m_nProcessing(nProcessing)
+    {}
+
+    void run() noexcept override
+    {
+        while (! bDone)
+        {
+            // The buffer is a member, ReceiveBulk buffers can not be on the thread stack
+            size_t nSize = ReceiveBulk (nTelemetry, m_aBuffer, m_nBufferSize, Timeout (50));
+
+            if (nSize >= sizeof (Header))
+            {
+                m_nFrames++;
+                m_nPartial += nSize < sizeof (m_aBuffer) ? 1 : 0;
+
+                Yield (m_nProcessing);
+            }
+        }
+
+        std::cout << m_pszName << ": " << m_nFrames << " frames, " << m_nPartial << " partial" << std::endl;
+
+        Wait (nPark, 1);
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return m_pszName;
+    }
+
+private:
+    const char* m_pszName;
+    size_t m_nBufferSize;
+    atomicx_time m_nProcessing;
+
+    size_t m_nFrames = 0;
+    size_t m_nPartial = 0;
+
+    uint8_t m_aBuffer[sizeof (Header) + nSamples * sizeof (int16_t)];
+    uint8_t stack[2048]={};
+};
+
+Reader logger ("Logger", sizeof (Header) + nSamples * sizeof (int16_t), 0);
+Reader display ("Display", sizeof (Header) + 16 * sizeof (int16_t), 0);
+Reader uplink ("Uplink", sizeof (Header) + nSamples * sizeof (int16_t), 25);
+
+class Broadcaster : public atomicx
+{
+public:
+    Broadcaster() : atomicx(stack)
+    {}
+
+    void run() noexcept override
+    {
+        size_t aServed[nReaders + 1] = {};
+
+        Yield (5);
+
+        uint64_t nStart = GetNanoseconds ();
+
+        for (uint32_t nFrame = 0; nFrame < nFrames; nFrame++)
+        {
+            Header header = {nFrame, nSamples};
+
+            for (size_t nIndex = 0; nIndex < nSamples; nIndex++)
+            {
+                m_aSamples [nIndex] = (int16_t) (nFrame + nIndex);
+            }
+
+            // Header from this stack and samples from the thread object, gathered into each reader
+            Segment aSegments[2] = {{(const uint8_t*) &header, sizeof (header)}, {(const uint8_t*) m_aSamples, sizeof (m_aSamples)}};
+            Delivery aDeliveries[nReaders];
+
+            aServed [SendV (nTelemetry, aSegments, 2, aDeliveries, nReaders, Timeout (2))]++;
+        }
+
+        uint64_t nElapsed = GetNanoseconds () - nStart;
+
+        std::cout << "Broadcaster: " << nFrames << " frames in " << (nElapsed / 1000000) << " ms, served by";
+
+        for (size_t nCount = 0; nCount <= nReaders; nCount++)
+        {
+            std::cout << " " << nCount << " readers: " << aServed [nCount] << (nCount < nReaders ? "," : "");
+        }
+
+        std::cout << std::endl;
+
+        bDone = true;
+
+        Wait (nPark, 1);
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return "Broadcaster";
+    }
+
+private:
+    int16_t m_aSamples[nSamples];
+    uint8_t stack[2048]={};
+};
+
+int main()
+{
+    Broadcaster broadcaster;
+
+    atomicx::Start();
+}
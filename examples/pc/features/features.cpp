@@ -0,0 +1,128 @@
+//
+//  features.cpp
+//  atomicx
+//
+//  Per thread footprint and context switch cost with the optional
+//  kernel features (auto stack, dynamic nice, broadcast and timing
+//  statistics) compiled in or out, see the makefile for the builds.
+//
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <cstdint>
+#include <iostream>
+
+#include "atomicx.hpp"
+
+using namespace thread;
+
+atomicx_time Atomicx_GetTick (void)
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+
+    return (atomicx_time)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+}
+
+void Atomicx_SleepTick(atomicx_time nSleep)
+{
+    usleep ((useconds_t)nSleep * 1000);
+}
+
+static uint64_t GetNanoseconds ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static const size_t nRounds = 500000;
+
+// Wait/Notify ping pong reference
+static uint8_t nPing = 0;
+
+/*
+ * Two workers first yield to each other, then play Wait/Notify
+ * ping pong, the reporter measures and prints
+ */
+class Worker : public atomicx
+{
+public:
+    Worker(bool bReporter) : atomicx(stack), m_bReporter(bReporter)
+    {
+        SetNice (0);
+    }
+
+    void run() noexcept override
+    {
+        uint64_t nStart = GetNanoseconds ();
+
+        for (size_t nCount = 0; nCount < nRounds; nCount++)
+        {
+            Yield (0);
+        }
+
+        Report ("Yield", nStart);
+
+        nStart = GetNanoseconds ();
+
+        for (size_t nCount = 0; nCount < nRounds; nCount++)
+        {
+            if (m_bReporter)
+            {
+                SyncNotify (nPing, 1);
+                Wait (nPing, 2);
+            }
+            else
+            {
+                Wait (nPing, 1);
+                SyncNotify (nPing, 2);
+            }
+        }
+
+        Report ("Wait/Notify", nStart);
+
+        Stop ();
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return m_bReporter ? "Reporter" : "Worker";
+    }
+
+private:
+
+    void Report (const char* pszWhat, uint64_t nStart)
+    {
+        if (m_bReporter)
+        {
+            uint64_t nElapsed = GetNanoseconds () - nStart;
+
+            std::cout << pszWhat << ": " << (nElapsed / (nRounds * 2)) << " ns per switch" << std::endl;
+        }
+    }
+
+    bool m_bReporter;
+    uint8_t stack[1024]="";
+};
+
+int main()
+{
+    std::cout << "Features: auto stack " << ATOMICX_AUTO_STACK << ", dynamic nice " << ATOMICX_DYNAMIC_NICE
+              << ", broadcast " << ATOMICX_BROADCAST << ", timing stats " << ATOMICX_TIMING_STATS << std::endl;
+
+    std::cout << "Thread control block: " << sizeof (atomicx) << " bytes" << std::endl;
+
+    Worker reporter(true);
+    Worker worker(false);
+
+    atomicx::Start();
+}
@@ -0,0 +1,146 @@
+//
+//  noheap.cpp
+//  atomicx
+//
+//  A kernel built with ATOMICX_NO_HEAP: fixed stacks, a queue<T, N>
+//  and a mutex. malloc/free are wrapped at link time and the global
+//  operator new/delete are replaced, any heap use aborts the program.
+//
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+
+#include "atomicx.hpp"
+
+using namespace thread;
+
+[[noreturn]] static void HeapTrap (const char* pszWho)
+{
+    printf ("Heap used by %s, ATOMICX_NO_HEAP violated\n", pszWho);
+    abort ();
+}
+
+extern "C"
+{
+    void* __wrap_malloc (size_t) { HeapTrap ("malloc"); }
+    void* __wrap_calloc (size_t, size_t) { HeapTrap ("calloc"); }
+    void* __wrap_realloc (void*, size_t) { HeapTrap ("realloc"); }
+    void __wrap_free (void* p) { if (p != nullptr) HeapTrap ("free"); }
+}
+
+void* operator new (size_t) { HeapTrap ("operator new"); }
+void operator delete (void* p) noexcept { if (p != nullptr) HeapTrap ("operator delete"); }
+void operator delete (void* p, size_t) noexcept { if (p != nullptr) HeapTrap ("operator delete"); }
+
+atomicx_time Atomicx_GetTick (void)
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+
+    return (atomicx_time)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+}
+
+void Atomicx_SleepTick(atomicx_time nSleep)
+{
+    usleep ((useconds_t)nSleep * 1000);
+}
+
+// Everything the kernel needs is declared statically
+atomicx::queue<int, 8> q;
+atomicx::mutex mtx;
+
+int nShared = 0;
+
+class Producer : public atomicx
+{
+public:
+    Producer() : atomicx(stack)
+    {}
+
+    void run() noexcept override
+    {
+        for (int nCount = 0; nCount < 100; nCount++)
+        {
+            q.PushBack (nCount);
+
+            mtx.Lock ();
+            nShared++;
+            Yield ();
+            mtx.Unlock ();
+        }
+
+        q.PushBack (-1);
+
+        // Park for good, Start() returns once no thread can run
+        Wait (nShared, 1);
+    }
+
+    void StackOverflowHandler(void) noexcept override
+    {
+        printf ("%s: stack overflow\n", GetName ());
+    }
+
+    const char* GetName(void) override
+    {
+        return "Producer";
+    }
+
+private:
+    uint8_t stack[1024]={};
+};
+
+class Consumer : public atomicx
+{
+public:
+    Consumer() : atomicx(stack)
+    {}
+
+    void run() noexcept override
+    {
+        int nValue;
+        int nSum = 0;
+
+        while ((nValue = q.Pop ()) >= 0)
+        {
+            nSum += nValue;
+
+            mtx.Lock ();
+            nShared++;
+            mtx.Unlock ();
+        }
+
+        printf ("%s: sum=%d shared=%d max queue=%zu\n", GetName (), nSum, nShared, q.GetMaxSize ());
+
+        Wait (nShared, 1);
+    }
+
+    void StackOverflowHandler(void) noexcept override
+    {
+        printf ("%s: stack overflow\n", GetName ());
+    }
+
+    const char* GetName(void) override
+    {
+        return "Consumer";
+    }
+
+private:
+    uint8_t stack[1024]={};
+};
+
+int main()
+{
+    Producer producer;
+    Consumer consumer;
+
+    atomicx::Start ();
+
+    printf ("No heap used\n");
+
+    return 0;
+}
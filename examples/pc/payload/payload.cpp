@@ -0,0 +1,200 @@
+//
+//  payload.cpp
+//  atomicx
+//
+//  Request/response between a client and a server thread carrying up to
+//  56 bytes each way: WaitPayload/SyncNotifyPayload (one notify per
+//  direction, built with ATOMICX_PAYLOAD_SIZE=56) against the
+//  Send/Receive pipe.
+//
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <cstdint>
+#include <iostream>
+
+#include "atomicx.hpp"
+
+using namespace thread;
+
+atomicx_time Atomicx_GetTick (void)
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+
+    return (atomicx_time)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+}
+
+void Atomicx_SleepTick(atomicx_time nSleep)
+{
+    usleep ((useconds_t)nSleep * 1000);
+}
+
+static uint64_t GetNanoseconds ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static const size_t nRounds = 20000;
+
+struct Request
+{
+    uint32_t nId;
+    int32_t aValues[12];
+};
+
+struct Response
+{
+    uint32_t nId;
+    int32_t nSum;
+    int32_t nMax;
+    int32_t aScaled[11];
+};
+
+// Server channel, tag 1 carries requests and tag 2 responses
+static uint32_t nServer = 0;
+
+static uint32_t nPark = 0;
+
+class Server : public atomicx
+{
+public:
+    Server() : atomicx(stack)
+    {}
+
+    void run() noexcept override
+    {
+        Request request;
+        Response response;
+
+        for (size_t nCount = 0; nCount < nRounds; nCount++)
+        {
+            WaitPayload (request, nServer, 1);
+            Serve (request, response);
+            SyncNotifyPayload (response, nServer, 2);
+        }
+
+        for (size_t nCount = 0; nCount < nRounds; nCount++)
+        {
+            Receive (nServer, (uint8_t*) &request, sizeof (request), Timeout (1000));
+            Serve (request, response);
+            Send (nServer, (uint8_t*) &response, sizeof (response), Timeout (1000));
+        }
+
+        Wait (nPark, 1);
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return "Server";
+    }
+
+private:
+
+    static void Serve (const Request& request, Response& response)
+    {
+        response.nId = request.nId;
+        response.nSum = 0;
+        response.nMax = request.aValues[0];
+
+        for (size_t nIndex = 0; nIndex < 12; nIndex++)
+        {
+            if (nIndex < 11)
+            {
+                response.aScaled[nIndex] = request.aValues[nIndex] * 2;
+            }
+
+            response.nSum += request.aValues[nIndex];
+            response.nMax = request.aValues[nIndex] > response.nMax ? request.aValues[nIndex] : response.nMax;
+        }
+    }
+
+    uint8_t stack[2048]={};
+};
+
+class Client : public atomicx
+{
+public:
+    Client() : atomicx(stack)
+    {}
+
+    void run() noexcept override
+    {
+        std::cout << "Request " << sizeof (Request) << " bytes, response " << sizeof (Response) << " bytes" << std::endl;
+
+        Measure ("payload", true);
+        Measure ("pipe", false);
+
+        Wait (nPark, 1);
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return "Client";
+    }
+
+private:
+
+    void Measure (const char* pszName, bool bPayload)
+    {
+        Request request;
+        Response response;
+        size_t nErrors = 0;
+
+        uint64_t nStart = GetNanoseconds ();
+
+        for (uint32_t nCount = 0; nCount < nRounds; nCount++)
+        {
+            request.nId = nCount;
+
+            for (int32_t nIndex = 0; nIndex < 12; nIndex++)
+            {
+                request.aValues[nIndex] = (int32_t) nCount + nIndex;
+            }
+
+            if (bPayload)
+            {
+                SyncNotifyPayload (request, nServer, 1);
+                WaitPayload (response, nServer, 2);
+            }
+            else
+            {
+                Send (nServer, (uint8_t*) &request, sizeof (request), Timeout (1000));
+                Receive (nServer, (uint8_t*) &response, sizeof (response), Timeout (1000));
+            }
+
+            nErrors += (response.nId != nCount || response.nSum != (int32_t) nCount * 12 + 66) ? 1 : 0;
+        }
+
+        uint64_t nElapsed = GetNanoseconds () - nStart;
+
+        std::cout << pszName << ": " << (nElapsed / nRounds) << " ns per request/response, errors " << nErrors << std::endl;
+    }
+
+    uint8_t stack[2048]={};
+};
+
+int main()
+{
+    Server server;
+    Client client;
+
+    std::cout << "Thread control block: " << sizeof (atomicx) << " bytes" << std::endl;
+
+    atomicx::Start();
+}
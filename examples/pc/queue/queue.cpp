@@ -0,0 +1,288 @@
+//
+//  queue.cpp
+//  atomicx
+//
+//  Push/Pop cost of the three queue storages: the linked list (an
+//  allocation per item), the ring inside queue<T, N> and the ring in a
+//  caller supplied buffer, uncontended and between two threads, item
+//  by item and with PushBatch/PopBatch.
+//
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "atomicx.hpp"
+
+using namespace thread;
+
+// Counts the allocations done by the queues
+static size_t nAllocations = 0;
+
+void* operator new (size_t nSize)
+{
+    nAllocations++;
+
+    void* p = malloc (nSize);
+
+    if (p == nullptr)
+    {
+        abort ();
+    }
+
+    return p;
+}
+
+void operator delete (void* p) noexcept
+{
+    free (p);
+}
+
+void operator delete (void* p, size_t) noexcept
+{
+    free (p);
+}
+
+atomicx_time Atomicx_GetTick (void)
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+
+    return (atomicx_time)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+}
+
+void Atomicx_SleepTick(atomicx_time nSleep)
+{
+    usleep ((useconds_t)nSleep * 1000);
+}
+
+static uint64_t GetNanoseconds ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static const size_t nQueueSize = 64;
+static const size_t nRounds = 1000000;
+
+struct Item
+{
+    uint32_t nSequence;
+    uint32_t nValue[3];
+};
+
+Item aBuffer[nQueueSize];
+
+atomicx::queue<Item> linkedQueue(nQueueSize);
+atomicx::queue<Item, nQueueSize> inlineQueue;
+atomicx::queue<Item> bufferQueue(aBuffer);
+
+static uint32_t nPark = 0;
+
+/*
+ * Runs all the measurements, the two thread ones with the help of Consumer
+ */
+class Producer : public atomicx
+{
+public:
+    Producer() : atomicx(stack)
+    {}
+
+    void run() noexcept override
+    {
+        std::cout << "Uncontended, push and pop of " << nQueueSize << " items per round, ns per item" << std::endl;
+
+        Uncontended ("linked", linkedQueue);
+        Uncontended ("inline", inlineQueue);
+        Uncontended ("buffer", bufferQueue);
+
+        std::cout << "Producer to consumer thread, ns per item" << std::endl;
+
+        Pipeline ("linked", linkedQueue, 1);
+        Pipeline ("inline", inlineQueue, 2);
+        Pipeline ("buffer", bufferQueue, 3);
+
+        std::cout << "Producer to consumer thread, batches of " << nQueueSize << ", ns per item" << std::endl;
+
+        Pipeline ("linked", linkedQueue, 4);
+        Pipeline ("inline", inlineQueue, 5);
+        Pipeline ("buffer", bufferQueue, 6);
+
+        Notify (nPark, 2);
+        Wait (nPark, 1);
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return "Producer";
+    }
+
+private:
+
+    template<typename Q> void Uncontended (const char* pszName, Q& queue)
+    {
+        size_t nStartAllocations = nAllocations;
+        uint32_t nCheck = 0;
+        uint64_t nStart = GetNanoseconds ();
+
+        for (size_t nCount = 0; nCount < nRounds; nCount += nQueueSize)
+        {
+            for (uint32_t nItem = 0; nItem < nQueueSize; nItem++)
+            {
+                queue.PushBack ({nItem, {0, 0, 0}});
+            }
+
+            for (uint32_t nItem = 0; nItem < nQueueSize; nItem++)
+            {
+                nCheck += queue.Pop ().nSequence == nItem ? 0 : 1;
+            }
+        }
+
+        Report (pszName, nStart, nStartAllocations, nCheck);
+    }
+
+    template<typename Q> void Pipeline (const char* pszName, Q& queue, size_t nQueue);
+
+    void Report (const char* pszName, uint64_t nStart, size_t nStartAllocations, uint32_t nErrors)
+    {
+        uint64_t nElapsed = GetNanoseconds () - nStart;
+
+        std::cout << "  " << pszName << ": " << ((double) nElapsed / nRounds) << " ns, "
+                  << ((double) (nAllocations - nStartAllocations) / nRounds) << " allocations per item"
+                  << (nErrors ? ", OUT OF ORDER" : "") << std::endl;
+    }
+
+    uint8_t stack[4096]={};
+};
+
+/*
+ * Pops nRounds items from the queue given by the producer
+ */
+class Consumer : public atomicx
+{
+public:
+    Consumer() : atomicx(stack)
+    {}
+
+    void run() noexcept override
+    {
+        size_t nQueue;
+
+        // Tag 1: the queue to consume, tag 2: done
+        while (Wait (nQueue, nPark, 2) && nQueue != 0)
+        {
+            m_nErrors = 0;
+
+            switch (nQueue)
+            {
+                case 1: Consume (linkedQueue); break;
+                case 2: Consume (inlineQueue); break;
+                case 3: Consume (bufferQueue); break;
+                case 4: ConsumeBatch (linkedQueue); break;
+                case 5: ConsumeBatch (inlineQueue); break;
+                case 6: ConsumeBatch (bufferQueue); break;
+            }
+
+            SyncNotify (nPark, 3);
+        }
+
+        Wait (nPark, 1);
+    }
+
+    template<typename Q> void Consume (Q& queue)
+    {
+        for (uint32_t nItem = 0; nItem < nRounds; nItem++)
+        {
+            m_nErrors += queue.Pop ().nSequence == nItem ? 0 : 1;
+        }
+    }
+
+    template<typename Q> void ConsumeBatch (Q& queue)
+    {
+        Item aItems[nQueueSize];
+
+        for (uint32_t nItem = 0; nItem < nRounds;)
+        {
+            size_t nCount = queue.PopBatch (aItems, nQueueSize);
+
+            for (size_t nIndex = 0; nIndex < nCount; nIndex++, nItem++)
+            {
+                m_nErrors += aItems[nIndex].nSequence == nItem ? 0 : 1;
+            }
+        }
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return "Consumer";
+    }
+
+    uint32_t m_nErrors = 0;
+
+private:
+
+    uint8_t stack[4096]={};
+};
+
+Consumer consumer;
+
+template<typename Q> void Producer::Pipeline (const char* pszName, Q& queue, size_t nQueue)
+{
+    size_t nStartAllocations = nAllocations;
+
+    SyncNotify (nQueue, nPark, 2);
+
+    uint64_t nStart = GetNanoseconds ();
+
+    if (nQueue <= 3)
+    {
+        for (uint32_t nItem = 0; nItem < nRounds; nItem++)
+        {
+            queue.PushBack ({nItem, {0, 0, 0}});
+        }
+    }
+    else
+    {
+        Item aItems[nQueueSize];
+
+        for (uint32_t nItem = 0; nItem < nRounds;)
+        {
+            size_t nCount = 0;
+
+            for (; nCount < nQueueSize && nItem < nRounds; nCount++, nItem++)
+            {
+                aItems[nCount] = {nItem, {0, 0, 0}};
+            }
+
+            queue.PushBatch (aItems, nCount);
+        }
+    }
+
+    Wait (nPark, 3);
+
+    Report (pszName, nStart, nStartAllocations, consumer.m_nErrors);
+}
+
+int main()
+{
+    Producer producer;
+
+    atomicx::Start();
+}
@@ -0,0 +1,165 @@
+//
+//  stackcopy.cpp
+//  atomicx
+//
+//  Measures the context switch cost of every stack copy kernel
+//  (ATOMICX_STACK_COPY_KERNELS) by the stack depth at the Yield point.
+//
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <cstdint>
+#include <iostream>
+
+#include "atomicx.hpp"
+
+using namespace thread;
+
+atomicx_time Atomicx_GetTick (void)
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+
+    return (atomicx_time)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+}
+
+void Atomicx_SleepTick(atomicx_time nSleep)
+{
+    usleep ((useconds_t)nSleep * 1000);
+}
+
+static uint64_t GetNanoseconds ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static const size_t nSwitches = 100000;
+static const size_t aDepths[] = {0, 1024, 2048, 4096, 8192};
+
+static const struct
+{
+    atomicx::StackCopy kernel;
+    const char* pszName;
+} aKernels[] = {
+    {atomicx::StackCopy::portable, "portable"},
+    {atomicx::StackCopy::sse2, "sse2"},
+    {atomicx::StackCopy::erms, "erms"},
+    {atomicx::StackCopy::avx2, "avx2"}
+};
+
+/*
+ * Two workers yield to each other the same number of times with
+ * the same stack depth, the reporter picks the kernel, measures
+ * and prints
+ */
+class Worker : public atomicx
+{
+public:
+    Worker(bool bReporter) : atomicx(stack), m_bReporter(bReporter)
+    {
+        SetNice (0);
+    }
+
+    void run() noexcept override
+    {
+        if (m_bReporter)
+        {
+            std::cout << "Start() picked kernels:";
+
+            for (size_t nDepth : aDepths)
+            {
+                std::cout << " " << nDepth << ": " << aKernels[(size_t) GetStackCopy (nDepth)].pszName;
+            }
+
+            std::cout << std::endl;
+        }
+
+        // Start() choice first, SetStackCopy() overrides it for good
+        for (size_t nDepth : aDepths)
+        {
+            Deep (nullptr, "by depth", nDepth, nDepth);
+        }
+
+        for (auto& kernel : aKernels)
+        {
+            for (size_t nDepth : aDepths)
+            {
+                Deep (&kernel.kernel, kernel.pszName, nDepth, nDepth);
+            }
+        }
+
+        Stop ();
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return m_bReporter ? "Reporter" : "Worker";
+    }
+
+private:
+
+    void Deep (const StackCopy* pKernel, const char* pszName, size_t nDepth, size_t nRemaining)
+    {
+        volatile uint8_t pad[256];
+
+        pad[0] = (uint8_t) nRemaining;
+
+        if (nRemaining > sizeof (pad))
+        {
+            Deep (pKernel, pszName, nDepth, nRemaining - sizeof (pad));
+        }
+        else
+        {
+            Switch (pKernel, pszName, nDepth);
+        }
+
+        (void) pad[0];
+    }
+
+    void Switch (const StackCopy* pKernel, const char* pszName, size_t nDepth)
+    {
+        if (m_bReporter && pKernel != nullptr && SetStackCopy (*pKernel) == false)
+        {
+            std::cout << pszName << ": not supported by this CPU" << std::endl;
+        }
+
+        // Both workers are in the loop with the kernel set
+        Yield (0);
+
+        uint64_t nStart = GetNanoseconds ();
+
+        for (size_t nCount = 0; nCount < nSwitches; nCount++)
+        {
+            Yield (0);
+        }
+
+        if (m_bReporter && (pKernel == nullptr || GetStackCopy () == *pKernel))
+        {
+            uint64_t nElapsed = GetNanoseconds () - nStart;
+
+            std::cout << pszName << ": depth: " << nDepth << " bytes, used stack: " << GetUsedStackSize ()
+                      << " bytes, " << (nElapsed / (nSwitches * 2)) << " ns per switch" << std::endl;
+        }
+    }
+
+    bool m_bReporter;
+    uint8_t stack[32768]="";
+};
+
+int main()
+{
+    Worker reporter(true);
+    Worker worker(false);
+
+    atomicx::Start();
+}
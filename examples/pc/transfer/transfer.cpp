@@ -0,0 +1,180 @@
+//
+//  transfer.cpp
+//  atomicx
+//
+//  Throughput by message size of the Send/Receive pipe, which moves
+//  sizeof(size_t)-1 bytes per rendezvous, against SendBulk/ReceiveBulk,
+//  which copies the whole message in a single rendezvous.
+//
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "atomicx.hpp"
+
+using namespace thread;
+
+atomicx_time Atomicx_GetTick (void)
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+
+    return (atomicx_time)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+}
+
+void Atomicx_SleepTick(atomicx_time nSleep)
+{
+    usleep ((useconds_t)nSleep * 1000);
+}
+
+static uint64_t GetNanoseconds ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static const size_t aSizes[] = { 16, 64, 256, 1024, 4096, 16384 };
+static const size_t nSizes = sizeof (aSizes) / sizeof (aSizes[0]);
+
+// Bytes moved per measurement, whatever the message size
+static const size_t nVolume = 1024 * 1024;
+
+// Off the thread stacks, ReceiveBulk buffers are written while the receiver is parked
+static uint8_t aSource[16384];
+static uint8_t aTarget[16384];
+
+static uint32_t nChannel = 0;
+static uint32_t nPark = 0;
+
+/*
+ * Sends every size through both transports and prints the throughput
+ */
+class Sender : public atomicx
+{
+public:
+    Sender() : atomicx(stack)
+    {}
+
+    void run() noexcept override
+    {
+        for (size_t nCount = 0; nCount < sizeof (aSource); nCount++)
+        {
+            aSource[nCount] = (uint8_t) nCount;
+        }
+
+        std::cout << "size\tpipe MB/s\tbulk MB/s" << std::endl;
+
+        for (size_t nSize = 0; nSize < nSizes; nSize++)
+        {
+            std::cout << aSizes[nSize] << "\t" << Measure (aSizes[nSize], false)
+                      << "\t\t" << Measure (aSizes[nSize], true) << std::endl;
+        }
+
+        // Size 0 ends the receiver
+        SyncNotify (0, nChannel, 1);
+        Wait (nPark, 1);
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return "Sender";
+    }
+
+private:
+
+    double Measure (size_t nSize, bool bBulk)
+    {
+        size_t nMessages = nVolume / nSize;
+        size_t nSent = 0;
+
+        // Tag 1 tells the receiver what comes next: size and transport
+        SyncNotify (nSize | (bBulk ? 0x10000 : 0), nChannel, 1);
+
+        uint64_t nStart = GetNanoseconds ();
+
+        for (size_t nCount = 0; nCount < nMessages; nCount++)
+        {
+            nSent += bBulk ? SendBulk (nChannel, aSource, nSize, Timeout (1000))
+                           : Send (nChannel, aSource, (uint16_t) nSize, Timeout (1000));
+        }
+
+        uint64_t nElapsed = GetNanoseconds () - nStart;
+
+        return nSent == nMessages * nSize ? (double) nSent * 1000.0 / (double) nElapsed : 0;
+    }
+
+    uint8_t stack[4096]={};
+};
+
+/*
+ * Receives what the sender announces and checks the last message
+ */
+class Receiver : public atomicx
+{
+public:
+    Receiver() : atomicx(stack)
+    {}
+
+    void run() noexcept override
+    {
+        size_t nNext;
+
+        // Tag 1: next measurement, size 0 when done
+        while (Wait (nNext, nChannel, 1) && nNext != 0)
+        {
+            size_t nSize = nNext & 0xffff;
+            size_t nMessages = nVolume / nSize;
+
+            for (size_t nCount = 0; nCount < nMessages; nCount++)
+            {
+                if ((nNext & 0x10000) ? ReceiveBulk (nChannel, aTarget, nSize, Timeout (1000)) != nSize
+                                      : Receive (nChannel, aTarget, (uint16_t) nSize, Timeout (1000)) != nSize)
+                {
+                    std::cout << "Transfer of " << nSize << " bytes failed" << std::endl;
+                    break;
+                }
+            }
+
+            if (memcmp (aSource, aTarget, nSize) != 0)
+            {
+                std::cout << "Transfer of " << nSize << " bytes corrupted" << std::endl;
+            }
+        }
+
+        Wait (nPark, 1);
+    }
+
+    void StackOverflowHandler (void) noexcept override
+    {
+        std::cout << __FUNCTION__ << ":" << GetName() << ": needed: " << GetUsedStackSize() << ", allocated: " << GetStackSize() << std::endl;
+    }
+
+    const char* GetName (void) override
+    {
+        return "Receiver";
+    }
+
+private:
+
+    uint8_t stack[4096]={};
+};
+
+int main()
+{
+    Sender sender;
+    Receiver receiver;
+
+    atomicx::Start();
+}